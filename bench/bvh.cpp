@@ -0,0 +1,376 @@
+// Rays per second on one thread through a plain binary BVH with one ray at a time, the wide
+// `BVH` with one ray at a time, and the wide `BVH` with `RayPacket`s. Camera rays test the
+// closest hit; the ambient occlusion rays leaving their hits test occlusion, as the preview
+// traces them.
+//
+// The lane count is fixed at build time: 4 (SSE) by default, 8 with APBR_ENABLE_AVX2.
+//
+// usage: apbr-bench-bvh [gridSize]
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <apbr/Camera.hpp>
+#include <apbr/geometry.hpp>
+#include <apbr/rng.hpp>
+#include <apbr/sampling.hpp>
+#include <apbr/TriangleMesh.hpp>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const glm::ivec2 resolution {256, 192};
+
+// rolling hills over a `size` x `size` grid of quads, seen at a grazing angle: rays that just
+// miss a hill crest go through a lot of the tree.
+std::shared_ptr<const apbr::TriangleMesh> terrain(int size)
+{
+    std::vector<glm::vec3> positions;
+    for (int z = 0; z <= size; ++z) {
+        for (int x = 0; x <= size; ++x) {
+            const auto u = static_cast<float>(x) / size * 2.0f - 1.0f;
+            const auto v = static_cast<float>(z) / size * 2.0f - 1.0f;
+            const auto h = 0.08f * std::sin(9.0f * u) * std::cos(7.0f * v)
+                         + 0.03f * std::sin(31.0f * u + 17.0f * v);
+            positions.push_back({u, h, v});
+        }
+    }
+    std::vector<std::uint32_t> indices;
+    const auto                 row = static_cast<std::uint32_t>(size + 1);
+    for (std::uint32_t z = 0; z < static_cast<std::uint32_t>(size); ++z) {
+        for (std::uint32_t x = 0; x < static_cast<std::uint32_t>(size); ++x) {
+            const auto i = z * row + x;
+            indices.insert(indices.end(), {i, i + row, i + 1, i + 1, i + row, i + row + 1});
+        }
+    }
+    return std::make_shared<const apbr::TriangleMesh>(std::move(positions), std::move(indices));
+}
+
+// The baseline: a binary binned SAH tree in depth first order, traversed one node at a time
+// with the nearer child first (PBR book, section 4.3).
+class BinaryBVH
+{
+public:
+    explicit BinaryBVH(const apbr::TriangleMesh &mesh) : m_mesh {mesh}
+    {
+        m_primitives.resize(mesh.triangleCount());
+        std::iota(m_primitives.begin(), m_primitives.end(), 0u);
+        m_bounds.reserve(mesh.triangleCount());
+        for (std::uint32_t i = 0; i < mesh.triangleCount(); ++i)
+            m_bounds.push_back(mesh.triangle(i).bounds());
+        m_nodes.reserve(2 * mesh.triangleCount());
+        build(0, static_cast<std::uint32_t>(m_primitives.size()));
+    }
+
+    bool intersect(apbr::Ray &ray) const { return traverse<false>(ray); }
+
+    bool occluded(const apbr::Ray &ray) const
+    {
+        auto r = ray;
+        return traverse<true>(r);
+    }
+
+private:
+    struct Node
+    {
+        apbr::Bounds3f bounds;
+        // second child for inner nodes, first primitive for leaves.
+        std::uint32_t  offset = 0;
+        std::uint16_t  count  = 0;
+        std::uint8_t   axis   = 0;
+    };
+
+    static constexpr int maxLeafSize = 4;
+    static constexpr int binCount    = 16;
+
+    std::uint32_t build(std::uint32_t begin, std::uint32_t end)
+    {
+        const auto index = static_cast<std::uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+
+        apbr::Bounds3f bounds, centroids;
+        for (auto i = begin; i < end; ++i) {
+            bounds.extend(m_bounds[m_primitives[i]]);
+            centroids.extend(m_bounds[m_primitives[i]].centroid());
+        }
+        m_nodes[index].bounds = bounds;
+
+        const auto count  = end - begin;
+        const int  axis   = centroids.maxDimension();
+        const auto extent = centroids.diagonal()[axis];
+        auto       mid    = begin + count / 2;
+        if (count <= maxLeafSize || extent <= 0.0f) {
+            m_nodes[index].offset = begin;
+            m_nodes[index].count  = static_cast<std::uint16_t>(count);
+            return index;
+        }
+
+        auto binOf = [&](std::uint32_t p) {
+            const auto x = (m_bounds[p].centroid()[axis] - centroids.lower[axis]) / extent;
+            return std::clamp(static_cast<int>(x * binCount), 0, binCount - 1);
+        };
+        apbr::Bounds3f binBounds[binCount];
+        std::uint32_t  binCounts[binCount] = {};
+        for (auto i = begin; i < end; ++i) {
+            const auto b = binOf(m_primitives[i]);
+            binBounds[b].extend(m_bounds[m_primitives[i]]);
+            ++binCounts[b];
+        }
+        int   bestSplit = 0;
+        float bestCost  = apbr::infinity;
+        for (int split = 0; split < binCount - 1; ++split) {
+            apbr::Bounds3f left, right;
+            std::uint32_t  nLeft = 0, nRight = 0;
+            for (int b = 0; b <= split; ++b) {
+                left.extend(binBounds[b]);
+                nLeft += binCounts[b];
+            }
+            for (int b = split + 1; b < binCount; ++b) {
+                right.extend(binBounds[b]);
+                nRight += binCounts[b];
+            }
+            const auto cost = nLeft * left.surfaceArea() + nRight * right.surfaceArea();
+            if (cost < bestCost) {
+                bestCost  = cost;
+                bestSplit = split;
+            }
+        }
+        auto it = std::partition(m_primitives.begin() + begin,
+                                 m_primitives.begin() + end,
+                                 [&](std::uint32_t p) { return binOf(p) <= bestSplit; });
+        mid     = static_cast<std::uint32_t>(it - m_primitives.begin());
+        if (mid == begin || mid == end)
+            mid = begin + count / 2;
+
+        m_nodes[index].axis = static_cast<std::uint8_t>(axis);
+        build(begin, mid);
+        m_nodes[index].offset = build(mid, end);
+        return index;
+    }
+
+    template<bool anyHit>
+    bool traverse(apbr::Ray &ray) const
+    {
+        const auto invDir = 1.0f / ray.direction;
+        const bool negative[3] = {invDir.x < 0.0f, invDir.y < 0.0f, invDir.z < 0.0f};
+
+        std::uint32_t stack[64];
+        int           top   = 0;
+        std::uint32_t index = 0;
+        bool          hit   = false;
+        for (;;) {
+            const auto &node = m_nodes[index];
+            if (overlaps(node.bounds, ray, invDir, negative)) {
+                if (node.count > 0) {
+                    for (auto i = node.offset; i < node.offset + node.count; ++i) {
+                        float t, b1, b2;
+                        if (apbr::intersect(ray, m_mesh.triangle(m_primitives[i]), t, b1, b2)) {
+                            if constexpr (anyHit)
+                                return true;
+                            ray.tMax = t;
+                            hit      = true;
+                        }
+                    }
+                } else if (negative[node.axis]) {
+                    stack[top++] = index + 1;
+                    index        = node.offset;
+                    continue;
+                } else {
+                    stack[top++] = node.offset;
+                    ++index;
+                    continue;
+                }
+            }
+            if (top == 0)
+                break;
+            index = stack[--top];
+        }
+        return hit;
+    }
+
+    static bool overlaps(const apbr::Bounds3f &b,
+                         const apbr::Ray      &ray,
+                         const glm::vec3      &invDir,
+                         const bool           *negative)
+    {
+        float tMin = 0.0f, tMax = ray.tMax;
+        for (int axis = 0; axis < 3; ++axis) {
+            const auto nearSide = negative[axis] ? b.upper[axis] : b.lower[axis];
+            const auto farSide  = negative[axis] ? b.lower[axis] : b.upper[axis];
+            tMin = std::max(tMin, (nearSide - ray.origin[axis]) * invDir[axis]);
+            tMax = std::min(tMax, (farSide - ray.origin[axis]) * invDir[axis]);
+        }
+        return tMin <= tMax * (1.0f + 2.0f * 3.0f * 0x1p-24f);
+    }
+
+private:
+    const apbr::TriangleMesh   &m_mesh;
+    std::vector<Node>           m_nodes;
+    std::vector<std::uint32_t>  m_primitives;
+    std::vector<apbr::Bounds3f> m_bounds;
+};
+
+// rays per second of `trace`, which goes through all `rays` once and returns the hit count.
+template<typename TraceFn>
+double raysPerSecond(std::span<const apbr::Ray> rays, std::size_t &hits, TraceFn &&trace)
+{
+    std::size_t traced  = 0;
+    const auto  start   = Clock::now();
+    double      seconds = 0.0;
+    do {
+        hits     = trace(rays);
+        traced  += rays.size();
+        seconds  = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (seconds < 0.5);
+    return static_cast<double>(traced) / seconds;
+}
+
+}    // namespace
+
+int main(int argc, char **argv)
+{
+    int gridSize = 256;
+    if (argc == 2) {
+        gridSize = std::atoi(argv[1]);
+    } else if (argc != 1) {
+        std::cerr << "usage: apbr-bench-bvh [gridSize]\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto      mesh  = terrain(gridSize);
+    auto            start = Clock::now();
+    const BinaryBVH binary {*mesh};
+    std::cout << std::format("{} triangles, {} lanes, binary BVH built in {:.2f} s\n",
+                             mesh->triangleCount(),
+                             apbr::RayPacket::size,
+                             std::chrono::duration<double>(Clock::now() - start).count());
+
+    // camera rays in scanline order, so a packet is `RayPacket::size` neighbouring pixels.
+    const apbr::Camera camera {glm::vec3 {0.0f, 0.35f, 1.6f},
+                               glm::vec3 {0.0f, 0.0f, 0.0f},
+                               glm::vec3 {0.0f, 1.0f, 0.0f},
+                               glm::radians(50.0f),
+                               static_cast<float>(resolution.x) / resolution.y};
+    std::vector<apbr::Ray> cameraRays;
+    for (int y = 0; y < resolution.y; ++y) {
+        for (int x = 0; x < resolution.x; ++x) {
+            const auto ndc = glm::vec2 {(x + 0.5f) / resolution.x * 2.0f - 1.0f,
+                                        1.0f - (y + 0.5f) / resolution.y * 2.0f};
+            cameraRays.push_back(camera.generateRayDifferential(ndc, glm::vec2 {0.0f}));
+        }
+    }
+
+    // one cosine weighted ray per camera ray that hits, in the same order.
+    std::vector<apbr::Ray> aoRays;
+    apbr::RNG              rng {7};
+    for (auto ray : cameraRays) {
+        apbr::Hit hit;
+        if (!mesh->intersect(ray, hit))
+            continue;
+        const auto tri = mesh->triangle(hit.primitive);
+        auto       n   = glm::normalize(glm::cross(tri.v1 - tri.v0, tri.v2 - tri.v0));
+        if (glm::dot(n, ray.direction) > 0.0f)
+            n = -n;
+        const auto u = glm::vec2 {rng.uniformFloat(), rng.uniformFloat()};
+        aoRays.push_back({ray.at(hit.t) + n * 1e-4f,
+                          apbr::fromLocal(n, apbr::sampleCosineHemisphere(u))});
+    }
+
+    auto packets = [](std::span<const apbr::Ray> rays, auto &&trace) {
+        std::size_t hits = 0;
+        for (std::size_t first = 0; first < rays.size(); first += apbr::RayPacket::size) {
+            apbr::RayPacket packet {};
+            const auto      n = std::min<std::size_t>(apbr::RayPacket::size, rays.size() - first);
+            packet.active     = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                packet.set(static_cast<int>(i), rays[first + i]);
+                packet.active |= 1u << i;
+            }
+            hits += std::popcount(trace(packet));
+        }
+        return hits;
+    };
+
+    struct Row
+    {
+        const char *name;
+        double      rate;
+        std::size_t hits;
+    };
+    auto report = [&](const char *what, std::span<const apbr::Ray> rays, std::span<Row> rows) {
+        std::cout << std::format("\n{}, {} rays:\n", what, rays.size());
+        for (const auto &row : rows) {
+            std::cout << std::format("  {:<14} {:8.2f} M rays/s {:6.2f}x   {} hits\n",
+                                     row.name,
+                                     row.rate * 1e-6,
+                                     row.rate / rows[0].rate,
+                                     row.hits);
+        }
+    };
+
+    Row closest[3];
+    closest[0].name = "binary";
+    closest[0].rate = raysPerSecond(cameraRays, closest[0].hits, [&](auto rays) {
+        std::size_t hits = 0;
+        for (auto ray : rays)
+            hits += binary.intersect(ray);
+        return hits;
+    });
+    closest[1].name = "wide";
+    closest[1].rate = raysPerSecond(cameraRays, closest[1].hits, [&](auto rays) {
+        std::size_t hits = 0;
+        for (auto ray : rays) {
+            apbr::Hit hit;
+            hits += mesh->intersect(ray, hit);
+        }
+        return hits;
+    });
+    closest[2].name = "wide, packets";
+    closest[2].rate = raysPerSecond(cameraRays, closest[2].hits, [&](auto rays) {
+        return packets(rays, [&](apbr::RayPacket &packet) {
+            apbr::PacketHit hit;
+            mesh->intersect(packet, hit);
+            std::uint32_t hits = 0;
+            for (int lane = 0; lane < apbr::RayPacket::size; ++lane)
+                hits |= std::uint32_t {hit.primitive[lane] != apbr::BVH::invalid} << lane;
+            return hits & packet.active;
+        });
+    });
+    report("camera rays, closest hit", cameraRays, closest);
+
+    Row occlusion[3];
+    occlusion[0].name = "binary";
+    occlusion[0].rate = raysPerSecond(aoRays, occlusion[0].hits, [&](auto rays) {
+        std::size_t hits = 0;
+        for (const auto &ray : rays)
+            hits += binary.occluded(ray);
+        return hits;
+    });
+    occlusion[1].name = "wide";
+    occlusion[1].rate = raysPerSecond(aoRays, occlusion[1].hits, [&](auto rays) {
+        std::size_t hits = 0;
+        for (const auto &ray : rays)
+            hits += mesh->occluded(ray);
+        return hits;
+    });
+    occlusion[2].name = "wide, packets";
+    occlusion[2].rate = raysPerSecond(aoRays, occlusion[2].hits, [&](auto rays) {
+        return packets(rays, [&](const apbr::RayPacket &packet) {
+            return mesh->occluded(packet);
+        });
+    });
+    report("ambient occlusion rays, any hit", aoRays, occlusion);
+}
@@ -0,0 +1,199 @@
+// Time per megapixel of the `Denoiser`, and the error of a low spp render before and after
+// denoising it, against a high spp render of the same scene.
+//
+// usage: apbr-bench-denoiser [width height spp referenceSpp]
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <apbr/Accel.hpp>
+#include <apbr/Camera.hpp>
+#include <apbr/Denoiser.hpp>
+#include <apbr/Film.hpp>
+#include <apbr/Integrator.hpp>
+#include <apbr/Sampler.hpp>
+#include <apbr/TaskScheduler.hpp>
+#include <apbr/TriangleMesh.hpp>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::shared_ptr<const apbr::TriangleMesh> box(const glm::vec3 &lo, const glm::vec3 &hi)
+{
+    std::vector<glm::vec3> corners;
+    for (int i = 0; i < 8; ++i)
+        corners.push_back({i & 1 ? hi.x : lo.x, i & 2 ? hi.y : lo.y, i & 4 ? hi.z : lo.z});
+    // two triangles per face, wound outwards.
+    std::vector<std::uint32_t> indices {0, 2, 3, 0, 3, 1, 4, 5, 7, 4, 7, 6,
+                                        0, 1, 5, 0, 5, 4, 2, 6, 7, 2, 7, 3,
+                                        0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5};
+    return std::make_shared<const apbr::TriangleMesh>(std::move(corners), std::move(indices));
+}
+
+// a floor with a few boxes on it, under the sky: contact shadows and soft gradients, the kind
+// of noise the preview shows.
+std::shared_ptr<const apbr::Accel> makeScene()
+{
+    const auto unitBox = box(glm::vec3 {-0.5f, 0.0f, -0.5f}, glm::vec3 {0.5f, 1.0f, 0.5f});
+
+    std::vector<apbr::Instance> instances;
+    instances.push_back({box(glm::vec3 {-4.0f, -0.1f, -4.0f}, glm::vec3 {4.0f, 0.0f, 4.0f}),
+                         glm::mat4 {1.0f},
+                         nullptr});
+    const glm::vec4 placements[] = {
+        // x, z, size, rotation around y
+        {-0.8f, -0.3f, 0.6f, 0.3f},
+        {0.5f, -0.6f, 0.9f, -0.5f},
+        {0.2f, 0.5f, 0.35f, 0.9f},
+    };
+    for (const auto &p : placements) {
+        auto transform = glm::translate(glm::mat4 {1.0f}, glm::vec3 {p.x, 0.0f, p.y});
+        transform      = glm::rotate(transform, p.w, glm::vec3 {0.0f, 1.0f, 0.0f});
+        transform      = glm::scale(transform, glm::vec3 {p.z});
+        instances.push_back({unitBox, transform, nullptr});
+    }
+    return std::make_shared<const apbr::Accel>(std::move(instances));
+}
+
+// `spp` samples per pixel into `film`, rows spread over the scheduler.
+void render(apbr::Film                &film,
+            const apbr::Integrator    &integrator,
+            const apbr::Camera        &camera,
+            const apbr::Sampler       &prototype,
+            int                        spp)
+{
+    const auto width     = film.width();
+    const auto height    = film.height();
+    const auto pixelSize = glm::vec2 {2.0f / width, 2.0f / height};
+    apbr::TaskScheduler::global().parallelFor(
+        0,
+        static_cast<std::size_t>(height),
+        1,
+        [&](std::size_t first, std::size_t last) {
+            const auto sampler = prototype.clone();
+            for (auto y = static_cast<int>(first); y < static_cast<int>(last); ++y) {
+                for (int x = 0; x < width; ++x) {
+                    for (int s = 0; s < spp; ++s) {
+                        sampler->startPixelSample({x, y}, s);
+                        const auto offset = sampler->getPixel2D();
+                        const auto ndc    = glm::vec2 {(x + offset.x) / width * 2.0f - 1.0f,
+                                                    1.0f - (y + offset.y) / height * 2.0f};
+                        apbr::PixelFeatures features;
+                        const auto          L = integrator.Li(
+                            camera.generateRayDifferential(ndc, pixelSize),
+                            *sampler,
+                            features);
+                        film.addSample(x, y, L, features);
+                    }
+                }
+            }
+        });
+}
+
+struct Error
+{
+    double rmse   = 0.0;
+    // mean of the squared error over the squared reference (plus a little, for black), as in
+    // the denoising literature.
+    double relMSE = 0.0;
+};
+
+Error error(std::span<const float> image, std::span<const float> reference)
+{
+    Error e;
+    for (std::size_t i = 0; i < image.size(); ++i) {
+        const double d  = image[i] - reference[i];
+        e.rmse         += d * d;
+        e.relMSE       += d * d / (reference[i] * reference[i] + 0.01);
+    }
+    e.rmse    = std::sqrt(e.rmse / image.size());
+    e.relMSE /= image.size();
+    return e;
+}
+
+}    // namespace
+
+int main(int argc, char **argv)
+{
+    int width        = 320;
+    int height       = 240;
+    int spp          = 4;
+    int referenceSpp = 256;
+    if (argc == 5) {
+        width        = std::atoi(argv[1]);
+        height       = std::atoi(argv[2]);
+        spp          = std::atoi(argv[3]);
+        referenceSpp = std::atoi(argv[4]);
+    } else if (argc != 1) {
+        std::cerr << "usage: apbr-bench-denoiser [width height spp referenceSpp]\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto               scene = makeScene();
+    const apbr::AOIntegrator integrator {scene};
+    const apbr::Camera       camera {glm::vec3 {0.0f, 1.6f, 2.6f},
+                                     glm::vec3 {0.0f, 0.2f, 0.0f},
+                                     glm::vec3 {0.0f, 1.0f, 0.0f},
+                                     glm::radians(45.0f),
+                                     static_cast<float>(width) / static_cast<float>(height)};
+    const apbr::Tile         image {0, 0, width, height};
+    const auto               pixels = static_cast<std::size_t>(width) * height;
+
+    // different seeds, so the reference doesn't share the noisy image's samples.
+    apbr::Film reference {width, height};
+    auto       start = Clock::now();
+    render(reference, integrator, camera, apbr::SobolSampler {referenceSpp, 1}, referenceSpp);
+    std::vector<float> referenceRGB(3 * pixels);
+    reference.resolve(image, referenceRGB);
+    std::cout << std::format("reference: {} x {}, {} spp in {:.1f} s\n",
+                             width,
+                             height,
+                             referenceSpp,
+                             secondsSince(start));
+
+    apbr::Film film {width, height};
+    render(film, integrator, camera, apbr::SobolSampler {spp}, spp);
+    std::vector<float> rgb(3 * pixels), albedo(3 * pixels), normal(3 * pixels), depth(pixels);
+    film.resolve(image, rgb);
+    film.resolveFeatures(image, albedo, normal, depth);
+
+    // the first call sizes the denoiser's buffers; time the ones after it.
+    apbr::Denoiser            denoiser;
+    const apbr::DenoiserInput input {width, height, rgb, albedo, normal, depth};
+    std::vector<float>        denoised(3 * pixels);
+    denoiser.denoise(input, denoised);
+    int runs = 0;
+    start    = Clock::now();
+    do {
+        denoiser.denoise(input, denoised);
+        ++runs;
+    } while (runs < 3 || secondsSince(start) < 0.5);
+    const auto milliseconds = secondsSince(start) * 1e3 / runs;
+
+    std::cout << std::format("denoise: {:.2f} ms per image, {:.2f} ms per megapixel\n",
+                             milliseconds,
+                             milliseconds * 1e6 / pixels);
+
+    const auto noisy   = error(rgb, referenceRGB);
+    const auto cleaned = error(denoised, referenceRGB);
+    std::cout << std::format("{} spp   {:>10} {:>10}\n", spp, "RMSE", "relMSE");
+    std::cout << std::format("  noisy    {:>10.3e} {:>10.3e}\n", noisy.rmse, noisy.relMSE);
+    std::cout << std::format("  denoised {:>10.3e} {:>10.3e}\n", cleaned.rmse, cleaned.relMSE);
+    std::cout << std::format("  relMSE {:.1f}x lower\n", noisy.relMSE / cleaned.relMSE);
+}
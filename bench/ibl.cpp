@@ -0,0 +1,123 @@
+// Time to build the `IBL` maps of a generated environment next to reloading them from the cache
+// file, and a check that the reloaded maps are the built ones: same sizes, same bits, mapped
+// rather than copied, and a miss for another key.
+//
+// usage: apbr-bench-ibl [width]
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <apbr/IBL.hpp>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr float pi = 3.14159265358979f;
+
+// a sky fading from blue at the zenith to a bright horizon over dark ground, with a small sun:
+// smooth light for the irradiance and a hot spot for the specular levels to blur.
+std::vector<float> environment(int width, int height)
+{
+    const glm::vec3    sunDirection = glm::normalize(glm::vec3 {0.4f, 0.6f, 0.3f});
+    std::vector<float> rgb;
+    rgb.reserve(static_cast<std::size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y) {
+        const float theta = pi * (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+        for (int x = 0; x < width; ++x) {
+            const float     phi = 2.0f * pi * (static_cast<float>(x) + 0.5f) / width;
+            const glm::vec3 d {std::sin(theta) * std::cos(phi),
+                               std::cos(theta),
+                               std::sin(theta) * std::sin(phi)};
+            glm::vec3       c = d.y > 0.0f
+                                  ? glm::mix(glm::vec3 {1.0f, 0.9f, 0.8f},
+                                             glm::vec3 {0.2f, 0.4f, 1.0f},
+                                             d.y)
+                                  : glm::vec3 {0.15f, 0.12f, 0.1f};
+            if (glm::dot(d, sunDirection) > 0.999f)
+                c += glm::vec3 {500.0f, 450.0f, 400.0f};
+            rgb.insert(rgb.end(), {c.x, c.y, c.z});
+        }
+    }
+    return rgb;
+}
+
+bool sameImage(const apbr::IBL::Image &a, const apbr::IBL::Image &b)
+{
+    return a.width == b.width && a.height == b.height && a.channels == b.channels
+        && a.texels.size() == b.texels.size()
+        && std::memcmp(a.texels.data(), b.texels.data(), a.texels.size_bytes()) == 0;
+}
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+}    // namespace
+
+int main(int argc, char **argv)
+{
+    const int width  = argc > 1 ? std::atoi(argv[1]) : 512;
+    const int height = width / 2;
+    if (width < 2) {
+        std::cerr << "usage: apbr-bench-ibl [width]\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto rgb  = environment(width, height);
+    const auto key  = apbr::IBL::hashSource(std::as_bytes(std::span {rgb}));
+    const auto path =
+        std::filesystem::temp_directory_path() / std::format("apbr-bench-ibl-{:016x}.bin", key);
+
+    auto            start = Clock::now();
+    const apbr::IBL built {width, height, rgb};
+    const auto      buildSeconds = secondsSince(start);
+
+    if (!built.writeCache(path, key)) {
+        std::cerr << "writeCache failed\n";
+        return EXIT_FAILURE;
+    }
+
+    start                  = Clock::now();
+    const auto loaded      = apbr::IBL::fromCache(path, key);
+    const auto loadSeconds = secondsSince(start);
+    const auto missed      = apbr::IBL::fromCache(path, key + 1);
+
+    bool same = loaded && loaded->mapped() && !missed
+             && loaded->specularLevels() == built.specularLevels()
+             && sameImage(loaded->irradiance(), built.irradiance())
+             && sameImage(loaded->brdf(), built.brdf());
+    for (int level = 0; same && level < built.specularLevels(); ++level)
+        same = sameImage(loaded->specular(level), built.specular(level));
+
+    std::error_code error;
+    const auto      fileSize = std::filesystem::file_size(path, error);
+    std::filesystem::remove(path, error);
+    if (!same) {
+        std::cerr << "the cache does not round-trip the maps\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::format("{}x{} environment, {} specular levels, {:.1f} MiB cache:\n",
+                             width,
+                             height,
+                             built.specularLevels(),
+                             static_cast<double>(fileSize) / (1 << 20));
+    std::cout << std::format("  {:<8} {:10.3f} ms\n", "build", buildSeconds * 1e3);
+    std::cout << std::format("  {:<8} {:10.3f} ms {:.0f}x\n",
+                             "cache",
+                             loadSeconds * 1e3,
+                             buildSeconds / loadSeconds);
+    return EXIT_SUCCESS;
+}
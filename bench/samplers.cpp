@@ -0,0 +1,238 @@
+// Throughput of every `Sampler`, of Sobol points generated one at a time next to
+// `sobolSamples` generating many at once, and how fast the samplers' estimates of two integrals
+// over the unit square converge next to `IndependentSampler`.
+//
+// usage: apbr-bench-samplers
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <apbr/lowdiscrepancy.hpp>
+#include <apbr/Sampler.hpp>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// pixels every estimate is repeated over; the error is the RMS over them.
+const glm::ivec2 resolution {32, 32};
+// dimensions a pixel sample draws in the throughput test, about what a short path needs.
+constexpr int    dimensionsPerSample = 8;
+constexpr int    throughputSpp       = 64;
+constexpr int    convergenceSpp[]    = {1, 4, 16, 64, 256};
+// points per `sobolSamples` call, e.g. one dimension of all samples of a tile.
+constexpr int    sobolBatchSize      = 4096;
+
+struct Candidate
+{
+    const char *name;
+    std::unique_ptr<apbr::Sampler> (*make)(int samplesPerPixel);
+};
+
+// the independent sampler first: it is what the others are compared to.
+const Candidate candidates[] = {
+    {"independent",
+     [](int spp) -> std::unique_ptr<apbr::Sampler> {
+         return std::make_unique<apbr::IndependentSampler>(spp);
+     }},
+    {"stratified",
+     [](int spp) -> std::unique_ptr<apbr::Sampler> {
+         const auto n = static_cast<int>(std::lround(std::sqrt(spp)));
+         return std::make_unique<apbr::StratifiedSampler>(n, n);
+     }},
+    {"halton",
+     [](int spp) -> std::unique_ptr<apbr::Sampler> {
+         return std::make_unique<apbr::HaltonSampler>(spp, resolution);
+     }},
+    {"sobol",
+     [](int spp) -> std::unique_ptr<apbr::Sampler> {
+         return std::make_unique<apbr::SobolSampler>(spp);
+     }},
+    {"zsobol",
+     [](int spp) -> std::unique_ptr<apbr::Sampler> {
+         return std::make_unique<apbr::ZSobolSampler>(spp, resolution);
+     }},
+};
+
+struct Integrand
+{
+    const char *name;
+    float (*f)(glm::vec2);
+    double      value;
+};
+
+const Integrand integrands[] = {
+    // smooth: (sqrt(pi) / 2 * erf(1))^2
+    {"gaussian",
+     [](glm::vec2 p) { return std::exp(-(p.x * p.x + p.y * p.y)); },
+     0.5577462853510336},
+    // discontinuous: pi / 4
+    {"quarter disk",
+     [](glm::vec2 p) { return p.x * p.x + p.y * p.y < 1.0f ? 1.0f : 0.0f; },
+     0.7853981633974483},
+};
+
+// pixel samples per second, drawing `dimensionsPerSample` dimensions each.
+double throughput(const Candidate &candidate)
+{
+    auto        sampler = candidate.make(throughputSpp);
+    float       sink    = 0.0f;
+    std::size_t samples = 0;
+
+    const auto  start   = Clock::now();
+    double      seconds = 0.0;
+    // a few rounds, so the timer's resolution doesn't matter.
+    while (seconds < 0.25) {
+        for (int y = 0; y < resolution.y; ++y) {
+            for (int x = 0; x < resolution.x; ++x) {
+                for (int s = 0; s < throughputSpp; ++s) {
+                    sampler->startPixelSample({x, y}, s);
+                    const auto offset = sampler->getPixel2D();
+                    sink += offset.x + offset.y;
+                    for (int d = 2; d < dimensionsPerSample; d += 2) {
+                        const auto u = sampler->get2D();
+                        sink += u.x + u.y;
+                    }
+                }
+            }
+        }
+        samples += static_cast<std::size_t>(resolution.x) * resolution.y * throughputSpp;
+        seconds  = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // keep the loop from being optimized away.
+    if (sink < 0.0f)
+        std::cout << sink;
+    return static_cast<double>(samples) / seconds;
+}
+
+// Sobol points per second over the first `dimensionsPerSample` dimensions, generated in batches
+// of `sobolBatchSize` consecutive indices by `generate(dimension, first, out)`.
+template<typename GenerateFn>
+double sobolThroughput(GenerateFn &&generate)
+{
+    std::vector<float> out(sobolBatchSize);
+    float              sink    = 0.0f;
+    std::size_t        samples = 0;
+    std::uint32_t      first   = 0;
+
+    const auto         start   = Clock::now();
+    double             seconds = 0.0;
+    while (seconds < 0.25) {
+        for (int dimension = 0; dimension < dimensionsPerSample; ++dimension) {
+            generate(dimension, first, out);
+            sink += out[first % sobolBatchSize];
+        }
+        first   += sobolBatchSize;
+        samples += static_cast<std::size_t>(sobolBatchSize) * dimensionsPerSample;
+        seconds  = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    if (sink < 0.0f)
+        std::cout << sink;
+    return static_cast<double>(samples) / seconds;
+}
+
+// RMS over the pixels of the error of estimating `integrand` with `spp` samples, using the
+// two dimensions after the pixel offset, as an integrator would.
+double rmsError(const Candidate &candidate, const Integrand &integrand, int spp)
+{
+    auto   sampler = candidate.make(spp);
+    double sum     = 0.0;
+    for (int y = 0; y < resolution.y; ++y) {
+        for (int x = 0; x < resolution.x; ++x) {
+            double estimate = 0.0;
+            for (int s = 0; s < spp; ++s) {
+                sampler->startPixelSample({x, y}, s);
+                sampler->getPixel2D();
+                estimate += integrand.f(sampler->get2D());
+            }
+            const auto error  = estimate / spp - integrand.value;
+            sum              += error * error;
+        }
+    }
+    return std::sqrt(sum / (resolution.x * resolution.y));
+}
+
+}    // namespace
+
+int main()
+{
+    std::cout << std::format("throughput, {} dimensions per pixel sample:\n",
+                             dimensionsPerSample);
+    for (const auto &candidate : candidates) {
+        const auto rate = throughput(candidate);
+        std::cout << std::format("  {:<12} {:8.2f} M samples/s {:8.2f} M dimensions/s\n",
+                                 candidate.name,
+                                 rate * 1e-6,
+                                 rate * dimensionsPerSample * 1e-6);
+    }
+
+    // the same points both ways; the batch is only worth having if it is faster.
+    constexpr std::uint32_t seed = 0x9e3779b9u;
+    auto one = [](int dimension, std::uint32_t first, std::vector<float> &out) {
+        for (std::size_t i = 0; i < out.size(); ++i)
+            out[i] = apbr::sobolSample(dimension, first + static_cast<std::uint32_t>(i), seed);
+    };
+    auto batch = [](int dimension, std::uint32_t first, std::vector<float> &out) {
+        apbr::sobolSamples(dimension, first, seed, out);
+    };
+    std::vector<float> a(sobolBatchSize), b(sobolBatchSize);
+    one(3, 12345, a);
+    batch(3, 12345, b);
+    if (a != b) {
+        std::cerr << "sobolSamples disagrees with sobolSample\n";
+        return EXIT_FAILURE;
+    }
+    const auto oneRate   = sobolThroughput(one);
+    const auto batchRate = sobolThroughput(batch);
+    std::cout << std::format("\nSobol points, batches of {} indices:\n", sobolBatchSize);
+    std::cout << std::format("  {:<12} {:8.2f} M dimensions/s\n", "sobolSample", oneRate * 1e-6);
+    std::cout << std::format("  {:<12} {:8.2f} M dimensions/s {:.1f}x\n",
+                             "sobolSamples",
+                             batchRate * 1e-6,
+                             batchRate / oneRate);
+
+    for (const auto &integrand : integrands) {
+        std::cout << std::format("\nRMS error, {} over {} x {} pixels:\n  {:>5}",
+                                 integrand.name,
+                                 resolution.x,
+                                 resolution.y,
+                                 "spp");
+        for (const auto &candidate : candidates)
+            std::cout << std::format(" {:>12}", candidate.name);
+        std::cout << '\n';
+
+        std::vector<std::vector<double>> errors(std::size(candidates));
+        for (const auto spp : convergenceSpp) {
+            std::cout << std::format("  {:>5}", spp);
+            for (std::size_t i = 0; i < std::size(candidates); ++i) {
+                errors[i].push_back(rmsError(candidates[i], integrand, spp));
+                std::cout << std::format(" {:>12.3e}", errors[i].back());
+            }
+            std::cout << '\n';
+        }
+
+        // slope of the error over the spp on a log-log scale; -0.5 for plain Monte Carlo.
+        std::cout << std::format("  {:>5}", "rate");
+        const auto logSppRange =
+            std::log(static_cast<double>(convergenceSpp[std::size(convergenceSpp) - 1])
+                     / convergenceSpp[0]);
+        for (const auto &error : errors) {
+            std::cout << std::format(" {:>12.2f}",
+                                     std::log(error.back() / error.front()) / logSppRange);
+        }
+        std::cout << "\n  vs independent at the highest spp:";
+        for (const auto &error : errors)
+            std::cout << std::format(" {:.1f}x", errors[0].back() / error.back());
+        std::cout << '\n';
+    }
+}
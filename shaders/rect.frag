@@ -8,6 +8,20 @@ uniform sampler2D bgTexture;
 uniform sampler2D fgTexture;
 uniform float fgOpacity;
 
+// set while showing the path traced preview: `bgTexture` then holds HDR radiance.
+uniform bool hdrPreview;
+uniform float exposure;
+
+// ACES filmic curve fit by Krzysztof Narkowicz.
+vec3 tonemapACES(vec3 x) {
+    return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
+
 void main() {
+    if (hdrPreview) {
+        vec3 mapped = tonemapACES(texture(bgTexture, TexCoord).rgb * exposure);
+        FragColor = vec4(pow(mapped, vec3(1.0 / 2.2)), 1.0);
+        return;
+    }
     FragColor = mix(texture(bgTexture, TexCoord), texture(fgTexture, vec2(-TexCoord.s, TexCoord.t)), fgOpacity);
-}
\ No newline at end of file
+}
@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iterator>
+
+#include <apbr/Accel.hpp>
+#include <apbr/Logger.hpp>
+
+namespace {
+
+// the top level has few primitives and each one is an entire BLAS, so keep leaves small.
+const apbr::BVH::BuildOptions topLevelOptions {.maxLeafSize   = 1,
+                                               .binCount      = 16,
+                                               .traversalCost = 1.0f};
+
+namespace simd = apbr::simd;
+
+}    // namespace
+
+namespace apbr {
+
+Accel::Accel(std::vector<Instance> instances)
+    : m_instances {std::move(instances)},
+      m_worldToObject(m_instances.size()),
+      m_worldBounds(m_instances.size())
+{
+    for (std::size_t i = 0; i < m_instances.size(); ++i)
+        updateInstance(i);
+
+    m_bvh.build(m_worldBounds, topLevelOptions);
+    m_builtCost = m_bvh.sahCost(topLevelOptions);
+}
+
+void Accel::updateInstance(std::size_t i)
+{
+    const auto &instance = m_instances[i];
+    m_worldToObject[i]   = glm::inverse(instance.objectToWorld);
+    m_worldBounds[i]     = instance.mesh
+                             ? transform(instance.objectToWorld, instance.mesh->bounds())
+                             : Bounds3f {};
+}
+
+void Accel::setTransforms(std::span<const glm::mat4> objectToWorld)
+{
+    if (objectToWorld.size() != m_instances.size()) {
+        logger.logError("apbr::Accel::setTransforms: one transform per instance expected.");
+        return;
+    }
+
+    for (std::size_t i = 0; i < m_instances.size(); ++i) {
+        m_instances[i].objectToWorld = objectToWorld[i];
+        updateInstance(i);
+    }
+    refitTopLevel();
+}
+
+void Accel::setTransforms(const Scene &scene, std::span<const Scene::Node> nodes)
+{
+    if (nodes.size() != m_instances.size()) {
+        logger.logError("apbr::Accel::setTransforms: one scene node per instance expected.");
+        return;
+    }
+
+    for (std::size_t i = 0; i < m_instances.size(); ++i) {
+        m_instances[i].objectToWorld = scene.world(nodes[i]);
+        updateInstance(i);
+    }
+    refitTopLevel();
+}
+
+void Accel::refitTopLevel()
+{
+    m_bvh.refit(m_worldBounds);
+    if (m_bvh.sahCost(topLevelOptions) > rebuildThreshold * m_builtCost) {
+        m_bvh.build(m_worldBounds, topLevelOptions);
+        m_builtCost = m_bvh.sahCost(topLevelOptions);
+        ++m_rebuilds;
+    }
+}
+
+bool Accel::intersect(Ray &ray, Hit &hit) const
+{
+    bool found = false;
+    m_bvh.intersect(ray, [&](std::uint32_t instance, Ray &r) {
+        const auto &mesh = m_instances[instance].mesh;
+        if (!mesh)
+            return false;
+
+        auto objectRay = toObject(m_worldToObject[instance], r);
+        if (!mesh->intersect(objectRay, hit))
+            return false;
+
+        r.tMax       = objectRay.tMax;
+        hit.instance = instance;
+        found        = true;
+        return true;
+    });
+    return found;
+}
+
+bool Accel::occluded(const Ray &ray) const
+{
+    return m_bvh.occluded(ray, [&](std::uint32_t instance, const Ray &r) {
+        const auto &mesh = m_instances[instance].mesh;
+        return mesh && mesh->occluded(toObject(m_worldToObject[instance], r));
+    });
+}
+
+void Accel::intersect(RayPacket &packet, PacketHit &hit) const
+{
+    for (int lane = 0; lane < RayPacket::size; ++lane) {
+        hit.primitive[lane] = BVH::invalid;
+        hit.instance[lane]  = BVH::invalid;
+    }
+
+    m_bvh.intersect(
+        packet,
+        [&](std::uint32_t instance, RayPacket &p, std::uint32_t lanes) -> std::uint32_t {
+            const auto &mesh = m_instances[instance].mesh;
+            if (!mesh)
+                return 0;
+
+            auto objectPacket   = toObject(m_worldToObject[instance], p);
+            objectPacket.active = lanes;
+            PacketHit objectHit;
+            mesh->intersect(objectPacket, objectHit);
+
+            std::uint32_t hits = 0;
+            for (auto b = lanes; b != 0; b &= b - 1) {
+                const int lane = std::countr_zero(b);
+                if (objectHit.primitive[lane] == BVH::invalid)
+                    continue;
+                p.tMax[lane]        = objectPacket.tMax[lane];
+                hit.b1[lane]        = objectHit.b1[lane];
+                hit.b2[lane]        = objectHit.b2[lane];
+                hit.primitive[lane] = objectHit.primitive[lane];
+                hit.instance[lane]  = instance;
+                hits               |= 1u << lane;
+            }
+            return hits;
+        });
+}
+
+std::uint32_t Accel::occluded(const RayPacket &packet) const
+{
+    return m_bvh.occluded(
+        packet,
+        [&](std::uint32_t instance, RayPacket &p, std::uint32_t lanes) -> std::uint32_t {
+            const auto &mesh = m_instances[instance].mesh;
+            if (!mesh)
+                return 0;
+
+            auto objectPacket   = toObject(m_worldToObject[instance], p);
+            objectPacket.active = lanes;
+            return mesh->occluded(objectPacket) & lanes;
+        });
+}
+
+RayPacket Accel::toObject(const glm::mat4 &worldToObject, const RayPacket &packet)
+{
+    // the same transform for every lane, so each output component is a sum of broadcasts
+    // times lanes. Directions stay unnormalized, as for single rays.
+    const simd::vfloat o[3] = {simd::load(packet.ox),
+                               simd::load(packet.oy),
+                               simd::load(packet.oz)};
+    const simd::vfloat d[3] = {simd::load(packet.dx),
+                               simd::load(packet.dy),
+                               simd::load(packet.dz)};
+
+    RayPacket result;
+    float    *origin[3]    = {result.ox, result.oy, result.oz};
+    float    *direction[3] = {result.dx, result.dy, result.dz};
+    for (int row = 0; row < 3; ++row) {
+        auto m = [&](int column) { return simd::broadcast(worldToObject[column][row]); };
+        simd::store(
+            origin[row],
+            simd::fmadd(o[0], m(0), simd::fmadd(o[1], m(1), simd::fmadd(o[2], m(2), m(3)))));
+        simd::store(direction[row],
+                    simd::fmadd(d[0], m(0), simd::fmadd(d[1], m(1), d[2] * m(2))));
+    }
+    std::copy(std::begin(packet.tMax), std::end(packet.tMax), result.tMax);
+    result.active = packet.active;
+    return result;
+}
+
+glm::vec3 Accel::normal(const Hit &hit) const
+{
+    const auto tri = m_instances[hit.instance].mesh->triangle(hit.primitive);
+    const auto n   = glm::cross(tri.v1 - tri.v0, tri.v2 - tri.v0);
+    // normals transform with the inverse transpose.
+    return glm::normalize(
+        glm::vec3 {glm::transpose(m_worldToObject[hit.instance])
+                   * glm::vec4 {n, 0.0f}});
+}
+
+TextureFootprint Accel::textureFootprint(const Hit             &hit,
+                                         const RayDifferential &ray) const
+{
+    const auto &instance = m_instances[hit.instance];
+    const auto  tri      = instance.mesh->triangle(hit.primitive);
+    const auto  uv       = instance.mesh->triangleUVs(hit.primitive);
+    const auto  b0       = 1.0f - hit.b1 - hit.b2;
+
+    TextureFootprint footprint;
+    footprint.st = b0 * uv[0] + hit.b1 * uv[1] + hit.b2 * uv[2];
+    if (!ray.hasDifferentials)
+        return footprint;
+
+    auto toWorld = [&](const glm::vec3 &p) {
+        return glm::vec3 {instance.objectToWorld * glm::vec4 {p, 1.0f}};
+    };
+    const auto p0 = toWorld(tri.v0);
+    const auto p1 = toWorld(tri.v1);
+    const auto p2 = toWorld(tri.v2);
+    const auto p  = b0 * p0 + hit.b1 * p1 + hit.b2 * p2;
+    const auto n  = glm::cross(p1 - p0, p2 - p0);
+
+    // where the neighbouring pixels' rays cross the tangent plane
+    const auto d  = glm::dot(n, p);
+    const auto nx = glm::dot(n, ray.rxDirection);
+    const auto ny = glm::dot(n, ray.ryDirection);
+    if (nx == 0.0f || ny == 0.0f)
+        return footprint;
+    const auto dpdx =
+        ray.rxOrigin + ray.rxDirection * ((d - glm::dot(n, ray.rxOrigin)) / nx) - p;
+    const auto dpdy =
+        ray.ryOrigin + ray.ryDirection * ((d - glm::dot(n, ray.ryOrigin)) / ny) - p;
+
+    // partial derivatives of the position along u and v
+    const auto duv02 = uv[0] - uv[2];
+    const auto duv12 = uv[1] - uv[2];
+    const auto dp02  = p0 - p2;
+    const auto dp12  = p1 - p2;
+    const auto det   = duv02.x * duv12.y - duv02.y * duv12.x;
+    if (std::abs(det) < 1e-12f)
+        return footprint;
+    const auto dpdu = (duv12.y * dp02 - duv02.y * dp12) / det;
+    const auto dpdv = (duv02.x * dp12 - duv12.x * dp02) / det;
+
+    // least squares fit of dpdx = dpdu * dudx + dpdv * dvdx (and the same for y)
+    const auto ata00  = glm::dot(dpdu, dpdu);
+    const auto ata01  = glm::dot(dpdu, dpdv);
+    const auto ata11  = glm::dot(dpdv, dpdv);
+    const auto invDet = 1.0f / (ata00 * ata11 - ata01 * ata01);
+    if (!std::isfinite(invDet))
+        return footprint;
+
+    auto solve = [&](const glm::vec3 &dp) {
+        const auto atb0 = glm::dot(dpdu, dp);
+        const auto atb1 = glm::dot(dpdv, dp);
+        const auto dst  = glm::vec2 {(ata11 * atb0 - ata01 * atb1) * invDet,
+                                    (ata00 * atb1 - ata01 * atb0) * invDet};
+        // grazing angles blow the footprint up; keep it finite.
+        return glm::clamp(dst, -1e8f, 1e8f);
+    };
+    footprint.dstdx = solve(dpdx);
+    footprint.dstdy = solve(dpdy);
+    return footprint;
+}
+
+}    // namespace apbr
@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <atomic>
+#include <memory_resource>
+#include <numeric>
+#include <vector>
+
+#include <apbr/BVH.hpp>
+#include <apbr/TaskScheduler.hpp>
+
+namespace {
+
+using apbr::Bounds3f;
+
+// binary tree produced by the SAH builder, collapsed into the wide layout afterwards.
+struct BuildNode
+{
+    Bounds3f      bounds;
+    // children for inner nodes, primitive range for leaves.
+    std::uint32_t left  = 0;
+    std::uint32_t right = 0;
+    std::uint32_t first = 0;
+    std::uint32_t count = 0;
+
+    bool          isLeaf() const { return count != 0; }
+};
+
+// the traversal stack is sized for this depth, see `BVH::stackSize`. Past half of it the
+// builder only does median splits, which can't need more than 32 further levels.
+constexpr int maxDepth = 64;
+constexpr int maxBins  = 64;
+
+// subtrees with at least this many primitives are built as separate tasks.
+constexpr std::uint32_t parallelBuildSize = 4096;
+
+class Builder
+{
+public:
+    Builder(std::span<const Bounds3f>           primitives,
+            std::vector<std::uint32_t>         &indices,
+            const apbr::BVH::BuildOptions      &options,
+            std::pmr::memory_resource          *scratch)
+        : m_bounds {primitives},
+          m_indices {indices},
+          m_options {options},
+          m_binCount {std::clamp(options.binCount, 2, maxBins)},
+          m_centroids {scratch},
+          m_nodes {scratch}
+    {
+        m_centroids.reserve(primitives.size());
+        for (const auto &b : primitives)
+            m_centroids.push_back(b.centroid());
+        // a binary tree over n primitives never has more than 2n - 1 nodes, so subtrees
+        // built on different threads can claim their nodes without locking.
+        m_nodes.resize(2 * primitives.size());
+    }
+
+    std::uint32_t build(std::uint32_t begin, std::uint32_t end, int depth)
+    {
+        const auto index = m_nodeCount.fetch_add(1, std::memory_order_relaxed);
+
+        Bounds3f bounds, centroidBounds;
+        for (auto i = begin; i < end; ++i) {
+            bounds.extend(m_bounds[m_indices[i]]);
+            centroidBounds.extend(m_centroids[m_indices[i]]);
+        }
+        m_nodes[index].bounds = bounds;
+
+        const auto count      = end - begin;
+        const auto maxLeaf    = static_cast<std::uint32_t>(m_options.maxLeafSize);
+        if (count == 1) {
+            makeLeaf(index, begin, count);
+            return index;
+        }
+
+        const int  axis   = centroidBounds.maxDimension();
+        const auto extent = centroidBounds.diagonal()[axis];
+
+        auto       mid    = begin + count / 2;
+        if (extent <= 0.0f || depth >= maxDepth / 2) {
+            // nothing to split spatially (or too deep): split by count to keep the tree balanced.
+            if (count <= maxLeaf) {
+                makeLeaf(index, begin, count);
+                return index;
+            }
+            std::nth_element(m_indices.begin() + begin,
+                             m_indices.begin() + mid,
+                             m_indices.begin() + end,
+                             [&](std::uint32_t a, std::uint32_t b) {
+                                 return m_centroids[a][axis]
+                                      < m_centroids[b][axis];
+                             });
+        } else {
+            const auto split = findSplit(begin, end, bounds, centroidBounds, axis);
+            if (split.leaf && count <= maxLeaf) {
+                makeLeaf(index, begin, count);
+                return index;
+            }
+
+            const auto lower = centroidBounds.lower[axis];
+            const auto scale = m_binCount / extent;
+            auto       it    = std::partition(
+                m_indices.begin() + begin,
+                m_indices.begin() + end,
+                [&](std::uint32_t i) {
+                    return binOf(m_centroids[i][axis], lower, scale, m_binCount)
+                        <= split.bin;
+                });
+            mid = static_cast<std::uint32_t>(it - m_indices.begin());
+            if (mid == begin || mid == end)
+                mid = begin + count / 2;
+        }
+
+        if (count >= parallelBuildSize) {
+            auto          &scheduler = apbr::TaskScheduler::global();
+            apbr::TaskGroup group;
+            scheduler.run(group, [this, index, begin, mid, depth] {
+                m_nodes[index].left = build(begin, mid, depth + 1);
+            });
+            m_nodes[index].right = build(mid, end, depth + 1);
+            scheduler.wait(group);
+        } else {
+            m_nodes[index].left  = build(begin, mid, depth + 1);
+            m_nodes[index].right = build(mid, end, depth + 1);
+        }
+        return index;
+    }
+
+    std::span<const BuildNode> nodes() const
+    {
+        return {m_nodes.data(), m_nodeCount.load()};
+    }
+
+private:
+    struct Split
+    {
+        int  bin  = 0;
+        bool leaf = false;
+    };
+
+    static int binOf(float c, float lower, float scale, int bins)
+    {
+        // empty primitives have NaN centroids; `!(x > 0)` puts them in the first bin.
+        const auto x = (c - lower) * scale;
+        return !(x > 0.0f) ? 0 : std::min(static_cast<int>(x), bins - 1);
+    }
+
+    void makeLeaf(std::uint32_t index, std::uint32_t first, std::uint32_t count)
+    {
+        m_nodes[index].first = first;
+        m_nodes[index].count = count;
+    }
+
+    // binned SAH: returns the last bin of the left side, or `leaf` if not splitting is cheaper.
+    Split findSplit(std::uint32_t   begin,
+                    std::uint32_t   end,
+                    const Bounds3f &bounds,
+                    const Bounds3f &centroidBounds,
+                    int             axis) const
+    {
+        struct Bin
+        {
+            Bounds3f      bounds;
+            std::uint32_t count = 0;
+        };
+
+        const int  bins  = m_binCount;
+        Bin        bin[maxBins];
+
+        const auto lower = centroidBounds.lower[axis];
+        const auto scale = bins / centroidBounds.diagonal()[axis];
+        for (auto i = begin; i < end; ++i) {
+            const auto p = m_indices[i];
+            auto      &b = bin[binOf(m_centroids[p][axis], lower, scale, bins)];
+            b.bounds.extend(m_bounds[p]);
+            ++b.count;
+        }
+
+        // sweep from the right to get the cost of every right side, then from the left.
+        float         rightCost[maxBins];
+        Bounds3f      acc;
+        std::uint32_t n = 0;
+        for (int i = bins - 1; i > 0; --i) {
+            acc.extend(bin[i].bounds);
+            n += bin[i].count;
+            rightCost[i - 1] = static_cast<float>(n) * acc.surfaceArea();
+        }
+
+        Split best;
+        auto  bestCost = apbr::infinity;
+        acc            = Bounds3f {};
+        n              = 0;
+        for (int i = 0; i < bins - 1; ++i) {
+            acc.extend(bin[i].bounds);
+            n += bin[i].count;
+            const auto cost = static_cast<float>(n) * acc.surfaceArea()
+                            + rightCost[i];
+            if (cost < bestCost) {
+                bestCost = cost;
+                best.bin = i;
+            }
+        }
+
+        const auto area     = bounds.surfaceArea();
+        const auto leafCost = static_cast<float>(end - begin);
+        const auto splitCost =
+            m_options.traversalCost + (area > 0.0f ? bestCost / area : 0.0f);
+        best.leaf = leafCost <= splitCost;
+        return best;
+    }
+
+private:
+    std::span<const Bounds3f>      m_bounds;
+    std::vector<std::uint32_t>    &m_indices;
+    const apbr::BVH::BuildOptions &m_options;
+    int                            m_binCount;
+    std::pmr::vector<glm::vec3>    m_centroids;
+    std::pmr::vector<BuildNode>    m_nodes;
+    std::atomic<std::uint32_t>     m_nodeCount {0};
+};
+
+}    // namespace
+
+namespace apbr {
+
+Bounds3f BVH::bounds() const
+{
+    Bounds3f b;
+    if (m_nodes.empty())
+        return b;
+
+    for (int slot = 0; slot < width; ++slot) {
+        if (m_nodes[0].used(slot))
+            b.extend(m_nodes[0].bounds(slot));
+    }
+    return b;
+}
+
+void BVH::build(std::span<const Bounds3f>  primitives,
+                const BuildOptions        &options,
+                std::pmr::memory_resource *scratch)
+{
+    m_nodes.clear();
+    m_primIndices.resize(primitives.size());
+    std::iota(m_primIndices.begin(), m_primIndices.end(), 0u);
+    if (primitives.empty())
+        return;
+
+    auto builder = Builder {primitives, m_primIndices, options, scratch};
+    builder.build(0, static_cast<std::uint32_t>(primitives.size()), 0);
+    const auto binary = builder.nodes();
+
+    // collapse: every wide node adopts up to `width` descendants of a binary node, always
+    // opening the inner child with the largest surface area first. Nodes are emitted in
+    // depth first order, so parents always precede their children.
+    auto collapse = [&](auto &self, std::uint32_t root) -> std::uint32_t {
+        std::uint32_t slots[width];
+        int           used = 0;
+        if (binary[root].isLeaf()) {
+            slots[used++] = root;
+        } else {
+            slots[used++] = binary[root].left;
+            slots[used++] = binary[root].right;
+        }
+
+        while (used < width) {
+            int   open = -1;
+            float area = -1.0f;
+            for (int i = 0; i < used; ++i) {
+                const auto &n = binary[slots[i]];
+                if (!n.isLeaf() && n.bounds.surfaceArea() > area) {
+                    area = n.bounds.surfaceArea();
+                    open = i;
+                }
+            }
+            if (open < 0)
+                break;
+
+            const auto &n   = binary[slots[open]];
+            slots[open]     = n.left;
+            slots[used++]   = n.right;
+        }
+
+        const auto index = static_cast<std::uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+        Node node;
+        for (int slot = 0; slot < width; ++slot) {
+            node.setBounds(slot, Bounds3f {});
+            node.child[slot] = invalid;
+            node.count[slot] = 0;
+        }
+
+        for (int slot = 0; slot < used; ++slot) {
+            const auto &n = binary[slots[slot]];
+            node.setBounds(slot, n.bounds);
+            if (n.isLeaf()) {
+                node.child[slot] = n.first;
+                node.count[slot] = n.count;
+            } else {
+                node.child[slot] = self(self, slots[slot]);
+            }
+        }
+        // `m_nodes` may have grown while recursing, so only store once the children exist.
+        m_nodes[index] = node;
+        return index;
+    };
+
+    m_nodes.reserve(binary.size() / 2 + 1);
+    collapse(collapse, 0);
+}
+
+void BVH::refit(std::span<const Bounds3f> primitives)
+{
+    // children always come after their parent, so walking backwards sees them first.
+    for (auto i = m_nodes.size(); i-- > 0;) {
+        auto &node = m_nodes[i];
+        for (int slot = 0; slot < width; ++slot) {
+            if (!node.used(slot))
+                continue;
+
+            Bounds3f b;
+            if (node.isLeaf(slot)) {
+                const auto first = node.child[slot];
+                for (auto k = first; k < first + node.count[slot]; ++k)
+                    b.extend(primitives[m_primIndices[k]]);
+            } else {
+                const auto &child = m_nodes[node.child[slot]];
+                for (int s = 0; s < width; ++s) {
+                    if (child.used(s))
+                        b.extend(child.bounds(s));
+                }
+            }
+            node.setBounds(slot, b);
+        }
+    }
+}
+
+float BVH::sahCost(const BuildOptions &options) const
+{
+    const auto rootArea = bounds().surfaceArea();
+    if (m_nodes.empty() || rootArea <= 0.0f)
+        return 0.0f;
+
+    // the probability of visiting a child is its area relative to the root.
+    float cost = options.traversalCost;
+    for (const auto &node : m_nodes) {
+        for (int slot = 0; slot < width; ++slot) {
+            if (!node.used(slot))
+                continue;
+
+            const auto p = node.bounds(slot).surfaceArea() / rootArea;
+            cost += p * (node.isLeaf(slot) ? static_cast<float>(node.count[slot])
+                                           : options.traversalCost);
+        }
+    }
+    return cost;
+}
+
+}    // namespace apbr
@@ -0,0 +1,32 @@
+#include <cmath>
+
+#include <apbr/Camera.hpp>
+
+namespace apbr {
+
+Ray Camera::generateRay(const glm::vec2 &ndc) const
+{
+    const auto forward = glm::normalize(m_target - m_position);
+    const auto right   = glm::normalize(glm::cross(forward, m_up));
+    const auto up      = glm::cross(right, forward);
+
+    const auto tanHalf = std::tan(m_fovY * 0.5f);
+    const auto dir     = forward + right * (ndc.x * tanHalf * m_aspect)
+                   + up * (ndc.y * tanHalf);
+    return Ray {m_position, glm::normalize(dir)};
+}
+
+RayDifferential Camera::generateRayDifferential(const glm::vec2 &ndc,
+                                                const glm::vec2 &pixelSize) const
+{
+    RayDifferential ray {generateRay(ndc)};
+    // `+y` is up in ndc, so the next pixel row is at `-pixelSize.y`.
+    ray.rxOrigin         = ray.origin;
+    ray.ryOrigin         = ray.origin;
+    ray.rxDirection      = generateRay(ndc + glm::vec2 {pixelSize.x, 0.0f}).direction;
+    ray.ryDirection      = generateRay(ndc - glm::vec2 {0.0f, pixelSize.y}).direction;
+    ray.hasDifferentials = true;
+    return ray;
+}
+
+}    // namespace apbr
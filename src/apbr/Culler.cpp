@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include <apbr/Culler.hpp>
+#include <apbr/Logger.hpp>
+#include <apbr/simd.hpp>
+
+namespace {
+
+namespace simd = apbr::simd;
+
+// one instance per leaf, so the leaf bounds tested by a node are the instances' own.
+const apbr::BVH::BuildOptions hierarchyOptions {.maxLeafSize   = 1,
+                                                .binCount      = 16,
+                                                .traversalCost = 1.0f};
+
+constexpr std::uint32_t allPlanes = (1u << apbr::Frustum::planeCount) - 1;
+
+// pyramid levels with fewer rows are reduced on the calling thread.
+constexpr int parallelRows = 256;
+
+// the corner of `b` farthest along `normal`, or nearest for `farthest == false`.
+glm::vec3 corner(const apbr::Bounds3f &b, const glm::vec3 &normal, bool farthest)
+{
+    glm::vec3 p;
+    for (int axis = 0; axis < 3; ++axis)
+        p[axis] = (normal[axis] >= 0.0f) == farthest ? b.upper[axis] : b.lower[axis];
+    return p;
+}
+
+}    // namespace
+
+namespace apbr {
+
+Frustum::Frustum(const glm::mat4 &viewProjection)
+{
+    // rows of the matrix; glm stores columns.
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; ++i) {
+        row[i] = {viewProjection[0][i],
+                  viewProjection[1][i],
+                  viewProjection[2][i],
+                  viewProjection[3][i]};
+    }
+    planes[Left]   = row[3] + row[0];
+    planes[Right]  = row[3] - row[0];
+    planes[Bottom] = row[3] + row[1];
+    planes[Top]    = row[3] - row[1];
+    planes[Near]   = row[3] + row[2];
+    planes[Far]    = row[3] - row[2];
+}
+
+bool Frustum::intersects(const Bounds3f &b) const
+{
+    if (b.empty())
+        return false;
+    for (const auto &plane : planes) {
+        const auto n = glm::vec3(plane);
+        if (glm::dot(n, corner(b, n, true)) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void HiZBuffer::build(int                    width,
+                      int                    height,
+                      std::span<const float> depth,
+                      TaskScheduler         &scheduler)
+{
+    if (width <= 0 || height <= 0
+        || depth.size() < static_cast<std::size_t>(width) * height) {
+        logger.logError("apbr::HiZBuffer::build: depth buffer smaller than its size.");
+        m_levels.clear();
+        return;
+    }
+
+    // one level per halving, down to 1 x 1. Odd sizes round up, so the last texel of a row
+    // covers a single texel of the level below.
+    const auto largest    = static_cast<unsigned>(std::max(width, height));
+    const auto levelCount = static_cast<std::size_t>(std::bit_width(largest));
+    m_levels.resize(levelCount);
+    for (std::size_t l = 0; l < levelCount; ++l) {
+        auto &level  = m_levels[l];
+        level.width  = l == 0 ? width : (m_levels[l - 1].width + 1) / 2;
+        level.height = l == 0 ? height : (m_levels[l - 1].height + 1) / 2;
+        level.depth.resize(static_cast<std::size_t>(level.width) * level.height);
+    }
+    std::copy_n(depth.begin(), m_levels[0].depth.size(), m_levels[0].depth.begin());
+
+    for (std::size_t l = 1; l < levelCount; ++l) {
+        const auto &src    = m_levels[l - 1];
+        auto       &dst    = m_levels[l];
+        auto        reduce = [&](std::size_t first, std::size_t last) {
+            for (auto y = static_cast<int>(first); y < static_cast<int>(last); ++y) {
+                const int y0 = 2 * y;
+                const int y1 = std::min(y0 + 1, src.height - 1);
+                for (int x = 0; x < dst.width; ++x) {
+                    const int x0 = 2 * x;
+                    const int x1 = std::min(x0 + 1, src.width - 1);
+                    dst.depth[static_cast<std::size_t>(y) * dst.width + x] =
+                        std::max(std::max(src.at(x0, y0), src.at(x1, y0)),
+                                 std::max(src.at(x0, y1), src.at(x1, y1)));
+                }
+            }
+        };
+        if (dst.height < parallelRows)
+            reduce(0, dst.height);
+        else
+            scheduler.parallelFor(0, dst.height, 32, reduce);
+    }
+}
+
+bool HiZBuffer::occluded(const Bounds3f &b, const glm::mat4 &viewProjection) const
+{
+    if (m_levels.empty() || b.empty())
+        return false;
+
+    // screen rectangle and nearest depth of the box, from its eight projected corners.
+    auto lower = glm::vec3 {infinity};
+    auto upper = glm::vec3 {-infinity};
+    for (int i = 0; i < 8; ++i) {
+        const auto p = viewProjection
+                     * glm::vec4 {i & 1 ? b.upper.x : b.lower.x,
+                                  i & 2 ? b.upper.y : b.lower.y,
+                                  i & 4 ? b.upper.z : b.lower.z,
+                                  1.0f};
+        // in front of the near plane the projection is unbounded (or flipped).
+        if (p.z < -p.w || p.w <= 0.0f)
+            return false;
+        const auto ndc = glm::vec3(p) / p.w;
+        lower          = glm::min(lower, ndc);
+        upper          = glm::max(upper, ndc);
+    }
+
+    const auto &base    = m_levels[0];
+    auto        toPixel = [](float ndc, int size) {
+        const auto pixel = static_cast<int>(std::floor((ndc * 0.5f + 0.5f) * size));
+        return std::clamp(pixel, 0, size - 1);
+    };
+    const int   x0      = toPixel(lower.x, base.width);
+    const int   x1      = toPixel(upper.x, base.width);
+    const int   y0      = toPixel(lower.y, base.height);
+    const int   y1      = toPixel(upper.y, base.height);
+    const float nearest = lower.z * 0.5f + 0.5f;
+
+    // the finest level where the rectangle covers at most 2 x 2 texels.
+    int level = 0;
+    while (level + 1 < levelCount()
+           && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+        ++level;
+
+    const auto &texels   = m_levels[level];
+    float       farthest = 0.0f;
+    for (int y = y0 >> level; y <= y1 >> level; ++y) {
+        for (int x = x0 >> level; x <= x1 >> level; ++x)
+            farthest = std::max(farthest, texels.at(x, y));
+    }
+    return nearest > farthest;
+}
+
+void Culler::setBounds(std::span<const Bounds3f> instances)
+{
+    const bool sameCount = instances.size() == m_bounds.size();
+    m_bounds.assign(instances.begin(), instances.end());
+    if (m_bounds.empty()) {
+        m_bvh = {};
+        return;
+    }
+
+    if (sameCount && !m_bvh.empty()) {
+        m_bvh.refit(m_bounds);
+        if (m_bvh.sahCost(hierarchyOptions) <= rebuildThreshold * m_builtCost)
+            return;
+    }
+    m_bvh.build(m_bounds, hierarchyOptions, &m_buildScratch);
+    m_buildScratch.reset();
+    m_builtCost = m_bvh.sahCost(hierarchyOptions);
+}
+
+std::span<const std::uint32_t> Culler::cull(const glm::mat4 &viewProjection,
+                                            const HiZBuffer *occluders)
+{
+    m_visible.clear();
+    m_stats = {};
+    if (m_bvh.empty())
+        return m_visible;
+    if (occluders && occluders->empty())
+        occluders = nullptr;
+
+    const auto frustum = Frustum {viewProjection};
+    const auto nodes   = m_bvh.nodes();
+    const auto indices = m_bvh.primitiveIndices();
+
+    // per plane and axis, whether its normal points to the upper side of the boxes.
+    simd::vfloat normal[Frustum::planeCount][3], offset[Frustum::planeCount];
+    bool         positive[Frustum::planeCount][3];
+    for (int p = 0; p < Frustum::planeCount; ++p) {
+        for (int axis = 0; axis < 3; ++axis) {
+            normal[p][axis]   = simd::broadcast(frustum.planes[p][axis]);
+            positive[p][axis] = frustum.planes[p][axis] >= 0.0f;
+        }
+        offset[p] = simd::broadcast(frustum.planes[p].w);
+    }
+    const auto zero = simd::broadcast(0.0f);
+
+    auto accept = [&](std::uint32_t first, std::uint32_t count, std::uint32_t planes) {
+        for (auto i = first; i < first + count; ++i) {
+            const auto  instance = indices[i];
+            const auto &b        = m_bounds[instance];
+            // leaves of more than one instance only happen when the builder runs out of depth.
+            if (count > 1) {
+                bool inside = !b.empty();
+                for (auto rest = planes; inside && rest != 0; rest &= rest - 1) {
+                    const auto &plane = frustum.planes[std::countr_zero(rest)];
+                    const auto  n     = glm::vec3(plane);
+                    inside            = glm::dot(n, corner(b, n, true)) + plane.w >= 0.0f;
+                }
+                if (!inside)
+                    continue;
+                if (occluders && occluders->occluded(b, viewProjection)) {
+                    ++m_stats.occluded;
+                    continue;
+                }
+            }
+            m_visible.push_back(instance);
+        }
+    };
+
+    m_stack.clear();
+    m_stack.push_back({0, allPlanes});
+    while (!m_stack.empty()) {
+        const auto entry = m_stack.back();
+        m_stack.pop_back();
+        const auto &node = nodes[entry.node];
+        ++m_stats.nodes;
+
+        // slots holding a child with anything in it.
+        std::uint32_t live = 0;
+        for (int slot = 0; slot < BVH::width; ++slot) {
+            if (node.used(slot) && node.lower[0][slot] <= node.upper[0][slot])
+                live |= 1u << slot;
+        }
+
+        // all children against every plane the node wasn't inside of: the corner farthest
+        // along the normal decides if a box is outside, the nearest one if it is inside.
+        std::uint32_t outside = 0;
+        std::uint32_t inside[Frustum::planeCount];
+        for (auto planes = entry.planes; planes != 0; planes &= planes - 1) {
+            const int p    = std::countr_zero(planes);
+            auto      farthest = offset[p];
+            auto      nearest  = offset[p];
+            for (int axis = 0; axis < 3; ++axis) {
+                const auto lower = simd::load(node.lower[axis]);
+                const auto upper = simd::load(node.upper[axis]);
+                const bool up    = positive[p][axis];
+                farthest = simd::fmadd(normal[p][axis], up ? upper : lower, farthest);
+                nearest  = simd::fmadd(normal[p][axis], up ? lower : upper, nearest);
+            }
+            outside   |= simd::bits(farthest < zero);
+            inside[p]  = simd::bits(nearest >= zero);
+        }
+
+        for (auto hits = live & ~outside; hits != 0; hits &= hits - 1) {
+            const int slot   = std::countr_zero(hits);
+            auto      planes = entry.planes;
+            for (auto rest = entry.planes; rest != 0; rest &= rest - 1) {
+                const int p = std::countr_zero(rest);
+                if (inside[p] >> slot & 1)
+                    planes &= ~(1u << p);
+            }
+            if (occluders && occluders->occluded(node.bounds(slot), viewProjection)) {
+                ++m_stats.occluded;
+                continue;
+            }
+            if (node.isLeaf(slot))
+                accept(node.child[slot], node.count[slot], planes);
+            else
+                m_stack.push_back({node.child[slot], planes});
+        }
+    }
+
+    m_stats.visible = m_visible.size();
+    return m_visible;
+}
+
+}    // namespace apbr
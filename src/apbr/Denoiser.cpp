@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <apbr/Denoiser.hpp>
+#include <apbr/TaskScheduler.hpp>
+#include <apbr/simd.hpp>
+
+namespace {
+
+namespace simd = apbr::simd;
+
+// albedo below this is clamped before dividing, so black texels don't blow up the noise.
+constexpr float minAlbedo = 1e-2f;
+
+// B3 spline, the 1D kernel of every iteration.
+constexpr float kernel[5] = {1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4, 1.0f / 16};
+
+// `simd::width` floats of `row` from `x` on, with the coordinates clamped to the row (so taps
+// beyond the border repeat the edge pixel).
+simd::vfloat loadBorder(const float *row, int x, int width)
+{
+    float lanes[simd::width];
+    for (int i = 0; i < simd::width; ++i)
+        lanes[i] = row[std::clamp(x + i, 0, width - 1)];
+    return simd::load(lanes);
+}
+
+// the common case, away from the border, is a plain load.
+inline simd::vfloat loadClamped(const float *row, int x, int width)
+{
+    if (x >= 0 && x + simd::width <= width) [[likely]]
+        return simd::load(row + x);
+    return loadBorder(row, x, width);
+}
+
+}    // namespace
+
+namespace apbr {
+
+Denoiser::Denoiser(const Options &options) : m_options {options} {}
+
+void Denoiser::resize(int width, int height)
+{
+    if (width == m_width && height == m_height)
+        return;
+
+    m_width  = width;
+    m_height = height;
+    m_tiles  = makeTiles(width, height, 64);
+
+    const auto pixels = static_cast<std::size_t>(width) * height;
+    for (auto *plane : {&m_color[0], &m_color[1], &m_albedo, &m_normal}) {
+        plane->x.resize(pixels);
+        plane->y.resize(pixels);
+        plane->z.resize(pixels);
+    }
+    m_depth.resize(pixels);
+}
+
+void Denoiser::denoise(const DenoiserInput &input, std::span<float> rgb)
+{
+    const auto pixels = static_cast<std::size_t>(input.width) * input.height;
+    if (input.width <= 0 || input.height <= 0 || input.color.size() < 3 * pixels
+        || input.albedo.size() < 3 * pixels || input.normal.size() < 3 * pixels
+        || input.depth.size() < pixels || rgb.size() < 3 * pixels)
+        throw std::runtime_error("apbr::Denoiser: image buffers don't match the size.");
+
+    resize(input.width, input.height);
+
+    auto &scheduler = TaskScheduler::global();
+    scheduler.parallelFor(0, pixels, 4096, [&](std::size_t first, std::size_t last) {
+        for (auto i = first; i < last; ++i) {
+            const auto *a = &input.albedo[3 * i];
+            const auto *n = &input.normal[3 * i];
+            const auto *c = &input.color[3 * i];
+            m_albedo.x[i] = std::max(a[0], minAlbedo);
+            m_albedo.y[i] = std::max(a[1], minAlbedo);
+            m_albedo.z[i] = std::max(a[2], minAlbedo);
+            m_normal.x[i] = n[0];
+            m_normal.y[i] = n[1];
+            m_normal.z[i] = n[2];
+            m_depth[i]    = input.depth[i];
+            m_color[0].x[i] = c[0] / m_albedo.x[i];
+            m_color[0].y[i] = c[1] / m_albedo.y[i];
+            m_color[0].z[i] = c[2] / m_albedo.z[i];
+        }
+    });
+
+    int   src        = 0;
+    float colorSigma = m_options.colorSigma;
+    for (int i = 0; i < m_options.iterations; ++i) {
+        scheduler.parallelForTiles(m_tiles, 16, [&](const Tile &tile) {
+            filterTile(tile, 1 << i, colorSigma, src);
+        });
+        src        ^= 1;
+        colorSigma *= 0.5f;
+    }
+
+    const auto &result = m_color[src];
+    scheduler.parallelFor(0, pixels, 4096, [&](std::size_t first, std::size_t last) {
+        for (auto i = first; i < last; ++i) {
+            rgb[3 * i]     = result.x[i] * m_albedo.x[i];
+            rgb[3 * i + 1] = result.y[i] * m_albedo.y[i];
+            rgb[3 * i + 2] = result.z[i] * m_albedo.z[i];
+        }
+    });
+}
+
+void Denoiser::filterTile(const Tile &tile, int step, float colorSigma, int src)
+{
+    const auto &in  = m_color[src];
+    auto       &out = m_color[src ^ 1];
+    const int   w   = m_width;
+
+    auto        bc  = [](float x) { return simd::broadcast(x); };
+    // e^-(|dc|^2 / sc^2 + |dn|^2 / (sn^2 step^2) + (dz / (sz z))^2), the step scaling the
+    // normal term as in the paper: far taps may only blend across smoother normals.
+    const auto  colorScale  = bc(-1.0f / std::max(colorSigma * colorSigma, 1e-8f));
+    const auto  normalScale = bc(-1.0f
+                                / std::max(m_options.normalSigma * m_options.normalSigma
+                                               * static_cast<float>(step * step),
+                                           1e-8f));
+    const auto  zero        = bc(0.0f);
+
+    for (int y = tile.y0; y < tile.y1; ++y) {
+        for (int x = tile.x0; x < tile.x1; x += simd::width) {
+            const auto   i  = static_cast<std::size_t>(y) * w;
+            const auto   cr = loadClamped(&in.x[i], x, w);
+            const auto   cg = loadClamped(&in.y[i], x, w);
+            const auto   cb = loadClamped(&in.z[i], x, w);
+            const auto   nx = loadClamped(&m_normal.x[i], x, w);
+            const auto   ny = loadClamped(&m_normal.y[i], x, w);
+            const auto   nz = loadClamped(&m_normal.z[i], x, w);
+            const auto   z  = loadClamped(&m_depth[i], x, w);
+            const auto   depthScale =
+                bc(-1.0f) / simd::max(bc(m_options.depthSigma * m_options.depthSigma) * z * z,
+                                      bc(1e-8f));
+
+            simd::vfloat sumR = zero, sumG = zero, sumB = zero, sumW = zero;
+            for (int ky = 0; ky < 5; ++ky) {
+                const auto qy = std::clamp(y + (ky - 2) * step, 0, m_height - 1);
+                const auto j  = static_cast<std::size_t>(qy) * w;
+                for (int kx = 0; kx < 5; ++kx) {
+                    const auto qx = x + (kx - 2) * step;
+                    const auto qr = loadClamped(&in.x[j], qx, w);
+                    const auto qg = loadClamped(&in.y[j], qx, w);
+                    const auto qb = loadClamped(&in.z[j], qx, w);
+
+                    const auto dr = qr - cr, dg = qg - cg, db = qb - cb;
+                    const auto dnx = loadClamped(&m_normal.x[j], qx, w) - nx;
+                    const auto dny = loadClamped(&m_normal.y[j], qx, w) - ny;
+                    const auto dnz = loadClamped(&m_normal.z[j], qx, w) - nz;
+                    const auto dz  = loadClamped(&m_depth[j], qx, w) - z;
+
+                    auto e = (dr * dr + dg * dg + db * db) * colorScale;
+                    e      = simd::fmadd(dnx * dnx + dny * dny + dnz * dnz, normalScale, e);
+                    e      = simd::fmadd(dz * dz, depthScale, e);
+                    const auto weight = bc(kernel[kx] * kernel[ky]) * simd::exp(e);
+
+                    sumR = simd::fmadd(weight, qr, sumR);
+                    sumG = simd::fmadd(weight, qg, sumG);
+                    sumB = simd::fmadd(weight, qb, sumB);
+                    sumW = sumW + weight;
+                }
+            }
+
+            // the center tap always has weight kernel[2]^2, so sumW > 0.
+            const auto inv   = bc(1.0f) / sumW;
+            const auto count = std::min(simd::width, tile.x1 - x);
+            simd::storePartial(&out.x[i + x], sumR * inv, count);
+            simd::storePartial(&out.y[i + x], sumG * inv, count);
+            simd::storePartial(&out.z[i + x], sumB * inv, count);
+        }
+    }
+}
+
+}    // namespace apbr
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <apbr/Film.hpp>
+
+namespace apbr {
+
+Film::Film(int width, int height)
+    : m_width {std::max(width, 1)},
+      m_height {std::max(height, 1)},
+      m_pixels(static_cast<std::size_t>(m_width) * m_height)
+{
+}
+
+void Film::reset()
+{
+    std::fill(m_pixels.begin(), m_pixels.end(), Pixel {});
+}
+
+float Film::error(const Tile &tile, float minBrightness) const
+{
+    if (tile.empty())
+        return 0.0f;
+
+    float total = 0.0f;
+    for (int y = tile.y0; y < tile.y1; ++y) {
+        for (int x = tile.x0; x < tile.x1; ++x) {
+            const auto &p = m_pixels[y * m_width + x];
+            if (p.count < 2.0f)
+                return std::numeric_limits<float>::infinity();
+
+            const auto variance   = (p.m2.x + p.m2.y + p.m2.z) / (3.0f * (p.count - 1.0f));
+            const auto brightness = std::max((p.mean.x + p.mean.y + p.mean.z) / 3.0f,
+                                             minBrightness);
+            total += variance / (p.count * brightness * brightness);
+        }
+    }
+    // averaging variances rather than errors: a pixel's sample variance is an unbiased
+    // estimate, its square root is not, and few samples of a rare event (say a little
+    // occlusion) often have no variance at all.
+    return std::sqrt(total / static_cast<float>(tile.area()));
+}
+
+void Film::resolve(const Tile &tile, std::span<float> rgb) const
+{
+    for (int y = tile.y0; y < tile.y1; ++y) {
+        auto *row = rgb.data() + 3 * static_cast<std::size_t>(m_height - 1 - y) * m_width;
+        for (int x = tile.x0; x < tile.x1; ++x) {
+            const auto c   = average(x, y);
+            row[3 * x]     = c.x;
+            row[3 * x + 1] = c.y;
+            row[3 * x + 2] = c.z;
+        }
+    }
+}
+
+void Film::resolveFeatures(const Tile       &tile,
+                           std::span<float> albedo,
+                           std::span<float> normal,
+                           std::span<float> depth) const
+{
+    for (int y = tile.y0; y < tile.y1; ++y) {
+        const auto row = static_cast<std::size_t>(m_height - 1 - y) * m_width;
+        for (int x = tile.x0; x < tile.x1; ++x) {
+            const auto &p = m_pixels[y * m_width + x];
+            const auto  i = row + x;
+            PixelFeatures mean;
+            if (p.count > 0.0f) {
+                mean.albedo = p.albedoSum / p.count;
+                mean.normal = p.normalSum / p.count;
+                mean.depth  = p.depthSum / p.count;
+            }
+            albedo[3 * i]     = mean.albedo.x;
+            albedo[3 * i + 1] = mean.albedo.y;
+            albedo[3 * i + 2] = mean.albedo.z;
+            normal[3 * i]     = mean.normal.x;
+            normal[3 * i + 1] = mean.normal.y;
+            normal[3 * i + 2] = mean.normal.z;
+            depth[i]          = mean.depth;
+        }
+    }
+}
+
+}    // namespace apbr
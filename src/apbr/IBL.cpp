@@ -0,0 +1,560 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+#include <apbr/IBL.hpp>
+#include <apbr/Logger.hpp>
+#include <apbr/lowdiscrepancy.hpp>
+#include <apbr/rng.hpp>
+#include <apbr/sampling.hpp>
+
+namespace {
+
+using apbr::pi;
+
+constexpr char          cacheMagic[8] = {'A', 'P', 'B', 'R', 'I', 'B', 'L', '1'};
+// bumped whenever the maps would come out differently, so old caches miss.
+constexpr std::uint64_t cacheVersion  = 1;
+
+// what `writeCache` puts before the images. Native byte order: cache files are meant for the
+// machine that wrote them.
+struct CacheHeader
+{
+    char          magic[8];
+    std::uint64_t key;
+    std::uint32_t imageCount;
+    std::uint32_t reserved;
+};
+
+// one per image, after the header.
+struct CacheEntry
+{
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t channels;
+    std::uint32_t reserved;
+    // from the start of the file.
+    std::uint64_t offset;
+};
+
+// images start on cache lines, in memory and in the file.
+constexpr std::size_t imageAlignment = 64 / sizeof(float);
+
+// the environment and its box filtered MIP chain, for filtered lookups by direction.
+class Environment
+{
+public:
+    Environment(int width, int height, std::span<const float> rgb)
+    {
+        m_levels.push_back({width, height, rgb});
+        while (m_levels.back().width > 1 || m_levels.back().height > 1) {
+            const auto &src = m_levels.back();
+            Level       dst {std::max(1, (src.width + 1) / 2),
+                             std::max(1, (src.height + 1) / 2),
+                             {}};
+            auto       &storage =
+                m_storage.emplace_back(3 * static_cast<std::size_t>(dst.width) * dst.height);
+            for (int y = 0; y < dst.height; ++y) {
+                const int y0 = 2 * y;
+                const int y1 = std::min(y0 + 1, src.height - 1);
+                for (int x = 0; x < dst.width; ++x) {
+                    const int  x0  = 2 * x;
+                    const int  x1  = std::min(x0 + 1, src.width - 1);
+                    const auto sum = src.texel(x0, y0) + src.texel(x1, y0) + src.texel(x0, y1)
+                                   + src.texel(x1, y1);
+                    const auto i   = 3 * (static_cast<std::size_t>(y) * dst.width + x);
+                    storage[i]     = sum.x * 0.25f;
+                    storage[i + 1] = sum.y * 0.25f;
+                    storage[i + 2] = sum.z * 0.25f;
+                }
+            }
+            dst.rgb = storage;
+            m_levels.push_back(dst);
+        }
+    }
+
+    int       width() const { return m_levels[0].width; }
+
+    int       height() const { return m_levels[0].height; }
+
+    int       levelCount() const { return static_cast<int>(m_levels.size()); }
+
+    // the finest level at most `maxWidth` texels wide.
+    int       levelNoWiderThan(int maxWidth) const
+    {
+        int level = 0;
+        while (level + 1 < levelCount() && m_levels[level].width > maxWidth)
+            ++level;
+        return level;
+    }
+
+    // trilinear: bilinear within the two levels around `lod`, which wrap around horizontally.
+    glm::vec3 sample(const glm::vec3 &direction, float lod) const
+    {
+        const auto uv = toEquirect(direction);
+        lod           = std::clamp(lod, 0.0f, static_cast<float>(levelCount() - 1));
+        const int   level = static_cast<int>(lod);
+        const float t     = lod - static_cast<float>(level);
+        const auto  fine  = m_levels[level].bilinear(uv);
+        if (t == 0.0f || level + 1 == levelCount())
+            return fine;
+        return fine + (m_levels[level + 1].bilinear(uv) - fine) * t;
+    }
+
+    // the texels of a level, for sums over the whole sphere.
+    int       levelWidth(int level) const { return m_levels[level].width; }
+
+    int       levelHeight(int level) const { return m_levels[level].height; }
+
+    glm::vec3 texel(int level, int x, int y) const { return m_levels[level].texel(x, y); }
+
+    static glm::vec2 toEquirect(const glm::vec3 &d)
+    {
+        auto phi = std::atan2(d.z, d.x);
+        if (phi < 0.0f)
+            phi += 2.0f * pi;
+        return {phi / (2.0f * pi), std::acos(std::clamp(d.y, -1.0f, 1.0f)) / pi};
+    }
+
+    // direction through the center of texel `(x, y)` of a `width` x `height` map.
+    static glm::vec3 direction(int x, int y, int width, int height)
+    {
+        const float phi   = 2.0f * pi * (static_cast<float>(x) + 0.5f) / static_cast<float>(width);
+        const float theta = pi * (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+        return {std::sin(theta) * std::cos(phi),
+                std::cos(theta),
+                std::sin(theta) * std::sin(phi)};
+    }
+
+private:
+    struct Level
+    {
+        int                    width  = 0;
+        int                    height = 0;
+        std::span<const float> rgb;
+
+        glm::vec3              texel(int x, int y) const
+        {
+            const auto i = 3 * (static_cast<std::size_t>(y) * width + x);
+            return {rgb[i], rgb[i + 1], rgb[i + 2]};
+        }
+
+        glm::vec3 bilinear(const glm::vec2 &uv) const
+        {
+            const float fx = uv.x * static_cast<float>(width) - 0.5f;
+            const float fy = uv.y * static_cast<float>(height) - 0.5f;
+            const float x0 = std::floor(fx);
+            const float y0 = std::floor(fy);
+            const float tx = fx - x0;
+            const float ty = fy - y0;
+
+            auto wrap      = [&](int x) { return ((x % width) + width) % width; };
+            auto clampY    = [&](int y) { return std::clamp(y, 0, height - 1); };
+            const int xa   = wrap(static_cast<int>(x0));
+            const int xb   = wrap(static_cast<int>(x0) + 1);
+            const int ya   = clampY(static_cast<int>(y0));
+            const int yb   = clampY(static_cast<int>(y0) + 1);
+
+            const auto top    = texel(xa, ya) + (texel(xb, ya) - texel(xa, ya)) * tx;
+            const auto bottom = texel(xa, yb) + (texel(xb, yb) - texel(xa, yb)) * tx;
+            return top + (bottom - top) * ty;
+        }
+    };
+
+    std::vector<Level>              m_levels;
+    std::vector<std::vector<float>> m_storage;
+};
+
+// real spherical harmonics up to order 2, at a unit direction.
+std::array<float, 9> shBasis(const glm::vec3 &d)
+{
+    return {0.282095f,
+            0.488603f * d.y,
+            0.488603f * d.z,
+            0.488603f * d.x,
+            1.092548f * d.x * d.y,
+            1.092548f * d.y * d.z,
+            0.315392f * (3.0f * d.z * d.z - 1.0f),
+            1.092548f * d.x * d.z,
+            0.546274f * (d.x * d.x - d.y * d.y)};
+}
+
+// `i`th of `count` points of the Hammersley set.
+glm::vec2 hammersley(std::uint32_t i, std::uint32_t count)
+{
+    return {(static_cast<float>(i) + 0.5f) / static_cast<float>(count),
+            apbr::toUnitFloat(apbr::reverseBits32(i))};
+}
+
+// GGX half vector around +z, and its cosine.
+glm::vec3 sampleGGX(const glm::vec2 &u, float alpha2)
+{
+    const float cosTheta = std::sqrt((1.0f - u.y) / (1.0f + (alpha2 - 1.0f) * u.y));
+    const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    const float phi      = 2.0f * pi * u.x;
+    return {sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta};
+}
+
+float distributionGGX(float cosTheta, float alpha2)
+{
+    const float d = cosTheta * cosTheta * (alpha2 - 1.0f) + 1.0f;
+    return alpha2 / (pi * d * d);
+}
+
+// one direction of Smith's masking for GGX, with the k Karis uses for image based lighting.
+float smithG1(float cosTheta, float k)
+{
+    return cosTheta / (cosTheta * (1.0f - k) + k);
+}
+
+// the environment around `n` convolved with a GGX lobe, assuming the view is along `n`.
+glm::vec3 prefilter(const Environment &environment,
+                    const glm::vec3   &n,
+                    float              roughness,
+                    int                samples)
+{
+    const float alpha  = roughness * roughness;
+    const float alpha2 = alpha * alpha;
+    // solid angle of a texel of the finest level on the equator, scaled by sin(theta) below.
+    const float texelSolidAngle =
+        2.0f * pi * pi
+        / (static_cast<float>(environment.width()) * static_cast<float>(environment.height()));
+
+    glm::vec3 t, b;
+    apbr::coordinateSystem(n, t, b);
+
+    glm::vec3 sum {0.0f};
+    float     weight = 0.0f;
+    for (int i = 0; i < samples; ++i) {
+        const auto local = sampleGGX(hammersley(i, samples), alpha2);
+        const auto h     = t * local.x + b * local.y + n * local.z;
+        const auto l     = 2.0f * local.z * h - n;
+        const auto cosL  = glm::dot(n, l);
+        if (cosL <= 0.0f)
+            continue;
+
+        // with v = n the pdf of `l` is D(h) * (n.h) / (4 v.h) = D(h) / 4. Read from the level
+        // where a texel covers about as much of the sphere as the sample does.
+        const float pdf         = distributionGGX(local.z, alpha2) * 0.25f;
+        const float sampleAngle = 1.0f / (static_cast<float>(samples) * pdf);
+        const float sinTheta    = std::sqrt(std::max(1.0f - l.y * l.y, 1e-4f));
+        const float lod =
+            0.5f * std::log2(sampleAngle / (texelSolidAngle * sinTheta)) + 1.0f;
+
+        sum    += environment.sample(l, lod) * cosL;
+        weight += cosL;
+    }
+    return weight > 0.0f ? sum / weight : glm::vec3 {0.0f};
+}
+
+// the split sum's scale and bias of F0 (Karis 2013, listing 3).
+glm::vec2 integrateBRDF(float cosV, float roughness, int samples)
+{
+    const float alpha  = roughness * roughness;
+    const float alpha2 = alpha * alpha;
+    const float k      = alpha * 0.5f;
+    const auto  v      = glm::vec3 {std::sqrt(1.0f - cosV * cosV), 0.0f, cosV};
+
+    glm::vec2 sum {0.0f};
+    for (int i = 0; i < samples; ++i) {
+        const auto  h    = sampleGGX(hammersley(i, samples), alpha2);
+        const float vh   = glm::dot(v, h);
+        const auto  l    = 2.0f * vh * h - v;
+        const float cosL = l.z;
+        if (cosL <= 0.0f || vh <= 0.0f)
+            continue;
+
+        const float g       = smithG1(cosV, k) * smithG1(cosL, k);
+        const float gVis    = g * vh / (h.z * cosV);
+        const float fresnel = std::pow(1.0f - vh, 5.0f);
+        sum += glm::vec2 {(1.0f - fresnel) * gVis, fresnel * gVis};
+    }
+    return sum / static_cast<float>(samples);
+}
+
+}    // namespace
+
+namespace apbr {
+
+IBL::IBL(int                    width,
+         int                    height,
+         std::span<const float> rgb,
+         const Options         &options,
+         TaskScheduler         &scheduler)
+{
+    if (width <= 0 || height <= 0 || rgb.size() < 3 * static_cast<std::size_t>(width) * height)
+        throw std::runtime_error("apbr::IBL: environment smaller than its size.");
+
+    const auto environment = Environment {width, height, rgb};
+
+    std::vector<Image> images;
+    images.push_back({options.irradianceSize, std::max(1, options.irradianceSize / 2), 3, {}});
+    images.push_back({options.brdfSize, options.brdfSize, 2, {}});
+    for (int level = 0; level < options.specularLevels; ++level) {
+        images.push_back({std::max(1, options.specularSize >> level),
+                          std::max(1, (options.specularSize / 2) >> level),
+                          3,
+                          {}});
+    }
+    allocate(std::move(images));
+    auto texels = [&](const Image &image) {
+        return m_storage.data() + (image.texels.data() - m_storage.data());
+    };
+
+    // every row is a task of its own; rows take up to a few ms each.
+    auto forEachRow = [&](const Image &image, auto &&body) {
+        scheduler.parallelFor(0, image.height, 1, [&](std::size_t first, std::size_t last) {
+            for (auto y = static_cast<int>(first); y < static_cast<int>(last); ++y) {
+                auto *row = texels(image)
+                          + static_cast<std::size_t>(y) * image.width * image.channels;
+                for (int x = 0; x < image.width; ++x)
+                    body(x, y, row + static_cast<std::size_t>(x) * image.channels);
+            }
+        });
+    };
+
+    // irradiance: project a coarse level onto the spherical harmonics (they can't tell it from
+    // the full resolution), then convolve with the clamped cosine, which scales every band.
+    {
+        const int level = environment.levelNoWiderThan(256);
+        const int w     = environment.levelWidth(level);
+        const int h     = environment.levelHeight(level);
+        std::vector<std::array<glm::vec3, 9>> rows(h);
+        scheduler.parallelFor(0, h, 1, [&](std::size_t first, std::size_t last) {
+            for (auto y = static_cast<int>(first); y < static_cast<int>(last); ++y) {
+                auto &row = rows[y];
+                row.fill(glm::vec3 {0.0f});
+                for (int x = 0; x < w; ++x) {
+                    const auto d     = Environment::direction(x, y, w, h);
+                    const auto basis = shBasis(d);
+                    const auto L     = environment.texel(level, x, y);
+                    for (int i = 0; i < 9; ++i)
+                        row[i] += L * basis[i];
+                }
+                // all texels of a row have the same solid angle.
+                const float theta =
+                    pi * (static_cast<float>(y) + 0.5f) / static_cast<float>(h);
+                const float solidAngle =
+                    2.0f * pi * pi * std::sin(theta) / static_cast<float>(w * h);
+                for (auto &c : row)
+                    c *= solidAngle;
+            }
+        });
+        std::array<glm::vec3, 9> sh {};
+        for (const auto &row : rows) {
+            for (int i = 0; i < 9; ++i)
+                sh[i] += row[i];
+        }
+        // cosine lobe per band, divided by pi.
+        constexpr float band[9] = {1.0f,
+                                   2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+                                   0.25f, 0.25f, 0.25f, 0.25f, 0.25f};
+        const auto &image = irradiance();
+        forEachRow(image, [&](int x, int y, float *out) {
+            const auto basis = shBasis(Environment::direction(x, y, image.width, image.height));
+            glm::vec3  e {0.0f};
+            for (int i = 0; i < 9; ++i)
+                e += sh[i] * (band[i] * basis[i]);
+            // order 2 rings around bright lights; negative light is worse than a little bias.
+            e      = glm::max(e, glm::vec3 {0.0f});
+            out[0] = e.x;
+            out[1] = e.y;
+            out[2] = e.z;
+        });
+    }
+
+    forEachRow(brdf(), [&](int x, int y, float *out) {
+        const auto &image     = brdf();
+        const float cosV      = (static_cast<float>(x) + 0.5f) / static_cast<float>(image.width);
+        // rows span roughness 0 to 1 like the specular levels, so both ends are exact.
+        const float roughness =
+            image.height > 1
+                ? static_cast<float>(y) / static_cast<float>(image.height - 1)
+                : 0.0f;
+        const auto  ab        = integrateBRDF(cosV, roughness, options.brdfSamples);
+        out[0]                = ab.x;
+        out[1]                = ab.y;
+    });
+
+    for (int level = 0; level < specularLevels(); ++level) {
+        const auto &image     = specular(level);
+        const float roughness =
+            specularLevels() > 1
+                ? static_cast<float>(level) / static_cast<float>(specularLevels() - 1)
+                : 0.0f;
+        // a mirror only needs the environment resampled, from the level of about its size.
+        const float mirrorLod = std::log2(static_cast<float>(environment.width())
+                                          / static_cast<float>(image.width));
+        forEachRow(image, [&](int x, int y, float *out) {
+            const auto n = Environment::direction(x, y, image.width, image.height);
+            const auto c = roughness > 0.0f
+                             ? prefilter(environment, n, roughness, options.specularSamples)
+                             : environment.sample(n, mirrorLod);
+            out[0]       = c.x;
+            out[1]       = c.y;
+            out[2]       = c.z;
+        });
+    }
+}
+
+void IBL::allocate(std::vector<Image> images)
+{
+    std::vector<std::size_t> offsets;
+    std::size_t              size = 0;
+    for (const auto &image : images) {
+        offsets.push_back(size);
+        const auto floats =
+            static_cast<std::size_t>(image.width) * image.height * image.channels;
+        size += (floats + imageAlignment - 1) / imageAlignment * imageAlignment;
+    }
+
+    m_storage.assign(size, 0.0f);
+    for (std::size_t i = 0; i < images.size(); ++i) {
+        auto &image  = images[i];
+        image.texels = {m_storage.data() + offsets[i],
+                        static_cast<std::size_t>(image.width) * image.height * image.channels};
+    }
+    m_images = std::move(images);
+}
+
+std::uint64_t IBL::hashSource(std::span<const std::byte> source, const Options &options)
+{
+    // four independent chains, so the multiplies of one overlap the others'.
+    std::uint64_t lanes[4] = {hash(cacheVersion, source.size()),
+                              hash(options.irradianceSize, options.specularSize),
+                              hash(options.specularLevels, options.specularSamples),
+                              hash(options.brdfSize, options.brdfSamples)};
+    std::size_t   i        = 0;
+    for (; i + 32 <= source.size(); i += 32) {
+        for (int lane = 0; lane < 4; ++lane) {
+            std::uint64_t word;
+            std::memcpy(&word, source.data() + i + 8 * lane, sizeof(word));
+            lanes[lane] = mixBits(lanes[lane] ^ word);
+        }
+    }
+    // the size went into the first lane, so zero padding the last word is unambiguous.
+    for (; i < source.size(); i += 8) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, source.data() + i, std::min<std::size_t>(8, source.size() - i));
+        lanes[0] = mixBits(lanes[0] ^ word);
+    }
+    return hash(lanes[0], lanes[1], lanes[2], lanes[3]);
+}
+
+std::optional<IBL> IBL::fromCache(const std::filesystem::path &path, std::uint64_t key)
+{
+    auto file = MappedFile::open(path);
+    if (!file)
+        return std::nullopt;
+
+    const auto  bytes = file->bytes();
+    CacheHeader header;
+    if (bytes.size() < sizeof(header))
+        return std::nullopt;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (!std::equal(std::begin(cacheMagic), std::end(cacheMagic), header.magic)
+        || header.key != key)
+        return std::nullopt;
+
+    const auto entriesEnd = sizeof(header) + header.imageCount * sizeof(CacheEntry);
+    if (header.imageCount < 2 || bytes.size() < entriesEnd) {
+        logger.logError(std::format("apbr::IBL::fromCache: `{}` is truncated or corrupt.",
+                                    path.string()));
+        return std::nullopt;
+    }
+
+    IBL ibl;
+    for (std::uint32_t i = 0; i < header.imageCount; ++i) {
+        CacheEntry entry;
+        std::memcpy(&entry, bytes.data() + sizeof(header) + i * sizeof(entry), sizeof(entry));
+        // every dimension is checked against what's left before multiplying, so a corrupt
+        // entry can't wrap the product around into something that fits.
+        const auto available = entry.offset <= bytes.size()
+                                 ? (bytes.size() - entry.offset) / sizeof(float)
+                                 : 0;
+        const bool fits = entry.width > 0 && entry.height > 0 && entry.channels > 0
+                       && entry.width <= available
+                       && entry.height <= available / entry.width
+                       && entry.channels
+                              <= available / (static_cast<std::size_t>(entry.width)
+                                              * entry.height);
+        if (entry.offset % alignof(float) != 0 || !fits) {
+            logger.logError(std::format("apbr::IBL::fromCache: `{}` is truncated or corrupt.",
+                                        path.string()));
+            return std::nullopt;
+        }
+        ibl.m_images.push_back(
+            {static_cast<int>(entry.width),
+             static_cast<int>(entry.height),
+             static_cast<int>(entry.channels),
+             {reinterpret_cast<const float *>(bytes.data() + entry.offset),
+              static_cast<std::size_t>(entry.width) * entry.height * entry.channels}});
+    }
+    ibl.m_file = std::move(file);
+    return ibl;
+}
+
+bool IBL::writeCache(const std::filesystem::path &path, std::uint64_t key) const
+{
+    CacheHeader header {};
+    std::copy(std::begin(cacheMagic), std::end(cacheMagic), header.magic);
+    header.key        = key;
+    header.imageCount = static_cast<std::uint32_t>(m_images.size());
+
+    // the images keep their offsets from each other, after the entries padded to a line.
+    const auto entriesEnd = sizeof(header) + m_images.size() * sizeof(CacheEntry);
+    const auto dataOffset = (entriesEnd + 63) / 64 * 64;
+    const auto *base      = m_images.front().texels.data();
+    std::size_t dataSize  = 0;
+
+    std::vector<CacheEntry> entries;
+    for (const auto &image : m_images) {
+        const auto offset =
+            static_cast<std::size_t>(image.texels.data() - base) * sizeof(float);
+        entries.push_back({static_cast<std::uint32_t>(image.width),
+                           static_cast<std::uint32_t>(image.height),
+                           static_cast<std::uint32_t>(image.channels),
+                           0,
+                           dataOffset + offset});
+        dataSize = std::max(dataSize, offset + image.texels.size_bytes());
+    }
+
+    // write next to the target and rename, so a crash or another process mapping the cache
+    // never sees half a file.
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream  stream {temporary, std::ios::binary};
+        constexpr char padding[64] = {};
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char *>(entries.data()),
+                     static_cast<std::streamsize>(entries.size() * sizeof(CacheEntry)));
+        stream.write(padding, static_cast<std::streamsize>(dataOffset - entriesEnd));
+        stream.write(reinterpret_cast<const char *>(base),
+                     static_cast<std::streamsize>(dataSize));
+        if (!stream) {
+            logger.logError(std::format("apbr::IBL::writeCache: failed to write `{}`.",
+                                        temporary.string()));
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        logger.logError(std::format("apbr::IBL::writeCache: failed to replace `{}`: {}",
+                                    path.string(),
+                                    error.message()));
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+}    // namespace apbr
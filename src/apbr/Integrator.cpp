@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <bit>
+
+#include <apbr/Integrator.hpp>
+#include <apbr/sampling.hpp>
+
+namespace apbr {
+
+void Integrator::LiPacket(std::span<const CameraSample> samples,
+                          Sampler                      &sampler,
+                          std::span<glm::vec3>          L,
+                          std::span<PixelFeatures>      features) const
+{
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        sampler.startPixelSample(samples[i].pixel, samples[i].index);
+        sampler.getPixel2D();
+        L[i] = Li(samples[i].ray, sampler, features[i]);
+    }
+}
+
+glm::vec3 AOIntegrator::Li(RayDifferential ray,
+                           Sampler        &sampler,
+                           PixelFeatures  &features) const
+{
+    Hit hit;
+    if (!m_scene->intersect(ray, hit))
+        return m_sky;
+
+    glm::vec3  n;
+    const auto albedo = shade(hit, ray, n, features);
+
+    // cosine weighted sampling cancels the cosine and the 1/pi of the diffuse BRDF.
+    if (m_scene->occluded(visibilityRay(hit, ray, n, sampler)))
+        return glm::vec3 {0.0f};
+    return albedo * m_sky;
+}
+
+void AOIntegrator::LiPacket(std::span<const CameraSample> samples,
+                            Sampler                      &sampler,
+                            std::span<glm::vec3>          L,
+                            std::span<PixelFeatures>      features) const
+{
+    const auto count = std::min<std::size_t>(samples.size(), RayPacket::size);
+
+    RayPacket  primary {};
+    primary.active = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        primary.set(static_cast<int>(i), samples[i].ray);
+        primary.active |= 1u << i;
+    }
+    PacketHit hits;
+    m_scene->intersect(primary, hits);
+
+    RayPacket visibility {};
+    visibility.active = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto lane = static_cast<int>(i);
+        if (hits.primitive[lane] == BVH::invalid) {
+            L[i] = m_sky;
+            continue;
+        }
+
+        const auto hit = hits.hit(primary, lane);
+        glm::vec3  n;
+        L[i] = shade(hit, samples[i].ray, n, features[i]) * m_sky;
+
+        sampler.startPixelSample(samples[i].pixel, samples[i].index);
+        sampler.getPixel2D();
+        visibility.set(lane, visibilityRay(hit, samples[i].ray, n, sampler));
+        visibility.active |= 1u << lane;
+    }
+
+    for (auto b = m_scene->occluded(visibility); b != 0; b &= b - 1)
+        L[std::countr_zero(b)] = glm::vec3 {0.0f};
+
+    // a longer span than a packet holds goes on packet by packet.
+    if (samples.size() > count)
+        LiPacket(samples.subspan(count), sampler, L.subspan(count), features.subspan(count));
+}
+
+glm::vec3 AOIntegrator::shade(const Hit             &hit,
+                              const RayDifferential &ray,
+                              glm::vec3             &n,
+                              PixelFeatures         &features) const
+{
+    n = m_scene->normal(hit);
+    if (glm::dot(n, ray.direction) > 0.0f)
+        n = -n;
+
+    auto albedo = m_albedo;
+    if (const auto &texture = m_scene->instances()[hit.instance].albedo)
+        albedo *= glm::vec3 {texture->lookup(m_scene->textureFootprint(hit, ray))};
+
+    features.albedo = albedo;
+    features.normal = n;
+    features.depth  = hit.t;
+    return albedo;
+}
+
+Ray AOIntegrator::visibilityRay(const Hit             &hit,
+                                const RayDifferential &ray,
+                                const glm::vec3       &n,
+                                Sampler               &sampler) const
+{
+    const auto dir = fromLocal(n, sampleCosineHemisphere(sampler.get2D()));
+    // offset along the normal so the visibility ray doesn't hit its own triangle.
+    const auto p   = ray.at(hit.t) + n * (1e-4f * (1.0f + hit.t));
+    return Ray {p, dir, m_maxDistance};
+}
+
+}    // namespace apbr
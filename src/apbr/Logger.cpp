@@ -1,9 +1,9 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-#include <string>
 #include <string_view>
 #include <iostream>
+#include <iterator>
 #include <format>
 #include <chrono>
 #include <source_location>
@@ -24,21 +24,8 @@ auto current_time()
     return std::chrono::system_clock::now();
 }
 
-std::string to_string(const std::chrono::system_clock::time_point &tp)
-{
-    return std::format("{:%F %T %Z}", as_localTime(tp));
-}
-
-std::string to_string(const std::source_location source)
-{
-    return std::format("{}: ({}:{}) `{}`",
-                       source.file_name(),
-                       source.line(),
-                       source.column(),
-                       source.function_name());
-}
-
-std::string to_string(const apbr::Log::Level level)
+// string literals, so logging a message doesn't build any strings of its own.
+std::string_view to_string(const apbr::Log::Level level)
 {
     switch (level) {
         using enum apbr::Log::Level;
@@ -59,7 +46,7 @@ std::string to_string(const apbr::Log::Level level)
     }
 }
 
-std::string LogLevelColor(const apbr::Log::Level level)
+std::string_view LogLevelColor(const apbr::Log::Level level)
 {
     switch (level) {
         using enum apbr::Log::Level;
@@ -81,17 +68,6 @@ std::string LogLevelColor(const apbr::Log::Level level)
     }
 }
 
-std::string formatLogData(const apbr::Log::Level     level,
-                          const std::string_view     message,
-                          const std::source_location source)
-{
-    return std::format("[{}] {} | {} | {}",
-                       to_string(level),
-                       to_string(current_time()),
-                       to_string(source),
-                       message);
-}
-
 }    // namespace
 
 namespace apbr::Log {
@@ -105,9 +81,18 @@ void Logger::log(const apbr::Log::Level     level,
         return;
 #endif
 
-    m_sink << LogLevelColor(level) << formatLogData(level, message, source)
-           << '\n'
-           << apbr::color::reset;
+    // formatted straight into the sink instead of through temporary strings.
+    std::format_to(std::ostreambuf_iterator<char> {m_sink},
+                   "{}[{}] {:%F %T %Z} | {}: ({}:{}) `{}` | {}\n{}",
+                   LogLevelColor(level),
+                   to_string(level),
+                   as_localTime(current_time()),
+                   source.file_name(),
+                   source.line(),
+                   source.column(),
+                   source.function_name(),
+                   message,
+                   apbr::color::reset);
 }
 
 Logger::Logger() : m_sink {std::clog}
@@ -0,0 +1,108 @@
+#include <utility>
+
+#include <apbr/MappedFile.hpp>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace apbr {
+
+std::optional<MappedFile> MappedFile::open(const std::filesystem::path &path)
+{
+    MappedFile file;
+#if defined(_WIN32)
+    const auto handle = CreateFileW(path.c_str(),
+                                    GENERIC_READ,
+                                    FILE_SHARE_READ,
+                                    nullptr,
+                                    OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL,
+                                    nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return std::nullopt;
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(handle, &size) && size.QuadPart > 0) {
+        file.m_mapping =
+            CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (file.m_mapping) {
+            file.m_data = static_cast<const std::byte *>(
+                MapViewOfFile(file.m_mapping, FILE_MAP_READ, 0, 0, 0));
+            file.m_size = static_cast<std::size_t>(size.QuadPart);
+        }
+    }
+    // the mapping keeps the file open.
+    CloseHandle(handle);
+#else
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return std::nullopt;
+
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        const auto size = static_cast<std::size_t>(status.st_size);
+        void *data      = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (data != MAP_FAILED) {
+            file.m_data = static_cast<const std::byte *>(data);
+            file.m_size = size;
+        }
+    }
+    // the mapping keeps the file open.
+    close(descriptor);
+#endif
+
+    if (!file.m_data)
+        return std::nullopt;
+    return file;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_data {std::exchange(other.m_data, nullptr)},
+      m_size {std::exchange(other.m_size, 0)}
+#if defined(_WIN32)
+      ,
+      m_mapping {std::exchange(other.m_mapping, nullptr)}
+#endif
+{
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other) {
+        unmap();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+#if defined(_WIN32)
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() { unmap(); }
+
+void MappedFile::unmap()
+{
+#if defined(_WIN32)
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    m_mapping = nullptr;
+#else
+    if (m_data)
+        munmap(const_cast<std::byte *>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+}    // namespace apbr
@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <format>
+#include <limits>
+
+#include <apbr/ProgressiveRenderer.hpp>
+#include <apbr/Logger.hpp>
+#include <apbr/TaskScheduler.hpp>
+
+namespace {
+
+constexpr int tileSize    = 32;
+constexpr int minTileSize = 8;
+// only a hint for the default sampler; passes keep going past it.
+constexpr int defaultSamplesPerPixel = 1024;
+
+}    // namespace
+
+namespace apbr {
+
+ProgressiveRenderer::ProgressiveRenderer(
+    int                               width,
+    int                               height,
+    std::shared_ptr<const Integrator> integrator,
+    const Camera                     &camera,
+    std::unique_ptr<Sampler>          sampler)
+    : m_film {width, height},
+      m_tiles {makeTiles(m_film.width(), m_film.height(), tileSize)},
+      m_sampler {sampler ? std::move(sampler)
+                         : std::make_unique<SobolSampler>(defaultSamplesPerPixel)},
+      m_camera {camera},
+      m_integrator {std::move(integrator)}
+{
+    const auto pixels = static_cast<std::size_t>(m_film.width()) * m_film.height();
+    for (auto &image : m_images) {
+        image.rgb.resize(3 * pixels);
+        image.albedo.resize(3 * pixels);
+        image.normal.resize(3 * pixels);
+        image.depth.resize(pixels);
+    }
+
+    m_thread = std::thread {[this] { renderLoop(); }};
+}
+
+ProgressiveRenderer::~ProgressiveRenderer()
+{
+    m_stop = true;
+    m_thread.join();
+}
+
+void ProgressiveRenderer::setCamera(const Camera &camera)
+{
+    std::lock_guard lock {m_sceneMutex};
+    if (camera == m_camera)
+        return;
+
+    m_camera = camera;
+    m_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ProgressiveRenderer::setIntegrator(
+    std::shared_ptr<const Integrator> integrator)
+{
+    std::lock_guard lock {m_sceneMutex};
+    m_integrator = std::move(integrator);
+    m_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ProgressiveRenderer::updateIntegrator(
+    std::shared_ptr<const Integrator> integrator)
+{
+    std::lock_guard lock {m_sceneMutex};
+    m_integrator = std::move(integrator);
+    m_integratorUpdated.store(true, std::memory_order_relaxed);
+}
+
+void ProgressiveRenderer::setAdaptiveSampling(const AdaptiveSampling &options)
+{
+    std::lock_guard lock {m_sceneMutex};
+    m_adaptive = options;
+    m_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+const ProgressiveRenderer::Image *ProgressiveRenderer::acquire()
+{
+    if ((m_ready.load(std::memory_order_acquire) & freshBit) == 0)
+        return nullptr;
+
+    m_reading = m_ready.exchange(m_reading, std::memory_order_acq_rel)
+              & ~freshBit;
+    return &m_images[m_reading];
+}
+
+int ProgressiveRenderer::cellOf(const Tile &tile) const
+{
+    const auto columns = (m_film.width() + tileSize - 1) / tileSize;
+    return tile.y0 / tileSize * columns + tile.x0 / tileSize;
+}
+
+void ProgressiveRenderer::renderLoop()
+{
+    using Clock = std::chrono::steady_clock;
+
+    auto                             &scheduler  = TaskScheduler::global();
+    auto                              generation = ~0u;
+    int                               pass       = 0;
+    Camera                            camera;
+    std::shared_ptr<const Integrator> integrator;
+    AdaptiveSampling                  adaptive;
+    Clock::time_point                 start;
+
+    const auto                        width      = m_film.width();
+    const auto                        height     = m_film.height();
+    const auto                        pixels     = static_cast<double>(width) * height;
+
+    // tiles still taking samples, and per grid cell (see `cellOf`) the samples per pixel of
+    // the current pass and the latest error estimate.
+    std::vector<Tile>                 active;
+    std::vector<int>                  samples(m_tiles.size());
+    std::vector<float>                errors(m_tiles.size());
+    double                            totalSamples = 0.0;
+
+    try {
+        while (!m_stop) {
+            const auto current = m_generation.load(std::memory_order_relaxed);
+            if (current != generation) {
+                {
+                    std::lock_guard lock {m_sceneMutex};
+                    camera     = m_camera;
+                    integrator = m_integrator;
+                    adaptive   = m_adaptive;
+                    m_integratorUpdated.store(false, std::memory_order_relaxed);
+                }
+                generation   = current;
+                pass         = 0;
+                start        = Clock::now();
+                active       = m_tiles;
+                totalSamples = 0.0;
+                m_film.reset();
+            } else if (m_integratorUpdated.exchange(false, std::memory_order_relaxed)) {
+                {
+                    std::lock_guard lock {m_sceneMutex};
+                    integrator = m_integrator;
+                }
+                // the tiles that stopped converged on the old scene.
+                active = m_tiles;
+            }
+            if (!integrator || active.empty()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds {1});
+                continue;
+            }
+
+            // every pixel of a tile always has the same number of samples. Once they can be
+            // trusted, a tile gets the samples its error estimate says it still needs (the
+            // error falls with the square root of the sample count), at most doubling them.
+            for (const auto &tile : active) {
+                const auto cell = cellOf(tile);
+                const auto n    = m_film.sampleCount(tile.x0, tile.y0);
+                samples[cell]   = 1;
+                if (adaptive.enabled && adaptive.targetError > 0.0f
+                    && n >= adaptive.minSamplesPerPixel) {
+                    const auto ratio  = errors[cell] / adaptive.targetError;
+                    const auto needed = std::ceil(n * (ratio * ratio - 1.0f));
+                    samples[cell]     = static_cast<int>(std::clamp(
+                        needed,
+                        1.0f,
+                        static_cast<float>(std::min(n, adaptive.maxSamplesPerPass))));
+                }
+            }
+
+            const auto pixelSize = glm::vec2 {2.0f / width, 2.0f / height};
+            scheduler.parallelForTiles(active, minTileSize, [&](Tile tile) {
+                if (abandoned(generation, pass))
+                    return;
+
+                const auto count   = samples[cellOf(tile)];
+                const auto sampler = m_sampler->clone();
+                // neighbouring pixels of a row go to the integrator together, so their rays
+                // can be traced as one packet.
+                CameraSample  batch[RayPacket::size];
+                glm::vec3     L[RayPacket::size];
+                PixelFeatures features[RayPacket::size];
+                for (int y = tile.y0; y < tile.y1; ++y) {
+                    for (int s = 0; s < count; ++s) {
+                        for (int x0 = tile.x0; x0 < tile.x1; x0 += RayPacket::size) {
+                            const auto n = std::min(RayPacket::size, tile.x1 - x0);
+                            for (int i = 0; i < n; ++i) {
+                                const auto pixel  = glm::ivec2 {x0 + i, y};
+                                const auto index  = m_film.sampleCount(pixel.x, y);
+                                sampler->startPixelSample(pixel, index);
+                                const auto offset = sampler->getPixel2D();
+                                const auto ndc    = glm::vec2 {
+                                    (pixel.x + offset.x) / width * 2.0f - 1.0f,
+                                    1.0f - (y + offset.y) / height * 2.0f};
+                                batch[i] = {pixel,
+                                            index,
+                                            camera.generateRayDifferential(ndc, pixelSize)};
+                                features[i] = {};
+                            }
+                            integrator->LiPacket({batch, static_cast<std::size_t>(n)},
+                                                 *sampler,
+                                                 {L, static_cast<std::size_t>(n)},
+                                                 {features, static_cast<std::size_t>(n)});
+                            for (int i = 0; i < n; ++i)
+                                m_film.addSample(x0 + i, y, L[i], features[i]);
+                        }
+                    }
+                }
+            });
+            if (abandoned(generation, pass))
+                continue;
+
+            ++pass;
+            for (const auto &tile : active)
+                totalSamples +=
+                    static_cast<double>(samples[cellOf(tile)]) * tile.area();
+
+            if (adaptive.enabled && adaptive.targetError > 0.0f) {
+                auto estimate = [&](std::size_t first, std::size_t last) {
+                    for (auto i = first; i < last; ++i) {
+                        const auto &tile = active[i];
+                        const auto  n   = m_film.sampleCount(tile.x0, tile.y0);
+                        errors[cellOf(tile)] =
+                            n < adaptive.minSamplesPerPixel
+                                ? std::numeric_limits<float>::infinity()
+                                : m_film.error(tile);
+                    }
+                };
+                scheduler.parallelFor(0, active.size(), 1, estimate);
+                std::erase_if(active, [&](const Tile &tile) {
+                    return errors[cellOf(tile)] <= adaptive.targetError;
+                });
+            }
+            if (adaptive.timeBudget > 0.0f
+                && std::chrono::duration<float>(Clock::now() - start).count()
+                       >= adaptive.timeBudget)
+                active.clear();
+
+            auto &image = m_images[m_writing];
+            scheduler.parallelForTiles(m_tiles, tileSize, [&](Tile tile) {
+                m_film.resolve(tile, image.rgb);
+                m_film.resolveFeatures(tile, image.albedo, image.normal, image.depth);
+            });
+            image.samplesPerPixel = static_cast<int>(std::lround(totalSamples / pixels));
+            image.finished        = active.empty();
+            m_writing = m_ready.exchange(m_writing | freshBit,
+                                         std::memory_order_acq_rel)
+                      & ~freshBit;
+        }
+    } catch (const std::exception &e) {
+        logger.logError(
+            std::format("apbr::ProgressiveRenderer stopped: {}", e.what()));
+    }
+}
+
+}    // namespace apbr
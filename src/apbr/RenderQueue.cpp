@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#include <apbr/RenderQueue.hpp>
+
+namespace apbr {
+
+std::uint64_t makeDrawKey(RenderPass    pass,
+                          std::uint32_t program,
+                          std::uint32_t material,
+                          float         depth)
+{
+    constexpr std::uint32_t depthMax = (1u << 24) - 1;
+
+    // `!(depth > 0)` also catches NaN.
+    auto d = !(depth > 0.0f) ? 0u
+           : depth >= 1.0f   ? depthMax
+                             : static_cast<std::uint32_t>(depth * depthMax);
+    if (pass == RenderPass::Transparent)
+        d = depthMax - d;
+
+    return (static_cast<std::uint64_t>(pass) << 56)
+         | (static_cast<std::uint64_t>(program & 0xffff) << 40)
+         | (static_cast<std::uint64_t>(material & 0xffff) << 24) | d;
+}
+
+RenderQueue::RenderQueue(TaskScheduler &scheduler)
+    : m_scheduler {&scheduler},
+      m_arenas(scheduler.threadCount())
+{
+}
+
+void RenderQueue::beginFrame()
+{
+    for (auto &arena : m_arenas) {
+        // the commands live in the arena, so they have to let go of it before it's reset;
+        // as many as last frame fit without growing the vector again.
+        const auto capacity = arena.commands.capacity();
+        std::pmr::vector<DrawCommand> {&arena.memory}.swap(arena.commands);
+        arena.memory.reset();
+        arena.commands.reserve(capacity);
+    }
+}
+
+RenderQueue::Stats RenderQueue::submit()
+{
+    m_items.clear();
+    for (std::uint32_t a = 0; a < m_arenas.size(); ++a) {
+        const auto &commands = m_arenas[a].commands;
+        for (std::uint32_t i = 0; i < commands.size(); ++i)
+            m_items.push_back({commands[i].key, a, i});
+    }
+
+    // LSD radix sort, a byte per pass. Stable, so draws with equal keys keep the order they
+    // were recorded in (per thread). Passes where every key has the same byte are skipped;
+    // with few programs and materials that's most of the high bytes.
+    m_scratch.resize(m_items.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+        std::array<std::size_t, 256> offsets {};
+        for (const auto &item : m_items)
+            ++offsets[(item.key >> shift) & 0xff];
+        if (std::find(offsets.begin(), offsets.end(), m_items.size()) != offsets.end())
+            continue;
+
+        std::size_t sum = 0;
+        for (auto &offset : offsets)
+            sum += std::exchange(offset, sum);
+        for (const auto &item : m_items)
+            m_scratch[offsets[(item.key >> shift) & 0xff]++] = item;
+        m_items.swap(m_scratch);
+    }
+
+    Stats  stats;
+    GLuint program                            = 0;
+    GLuint vertexArray                        = 0;
+    GLuint textures[DrawCommand::maxTextures] = {};
+    for (const auto &item : m_items) {
+        const auto &command = m_arenas[item.arena].commands[item.index];
+        if (command.program != program || stats.draws == 0) {
+            program = command.program;
+            glUseProgram(program);
+            ++stats.programChanges;
+        }
+        if (command.vertexArray != vertexArray || stats.draws == 0) {
+            vertexArray = command.vertexArray;
+            glBindVertexArray(vertexArray);
+            ++stats.vertexArrayChanges;
+        }
+        for (int unit = 0; unit < DrawCommand::maxTextures; ++unit) {
+            const auto texture = command.textures[unit];
+            if (texture == 0 || texture == textures[unit])
+                continue;
+            textures[unit] = texture;
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            ++stats.textureChanges;
+        }
+        if (command.transformLocation >= 0) {
+            glUniformMatrix4fv(command.transformLocation,
+                               1,
+                               GL_FALSE,
+                               &command.transform[0][0]);
+        }
+        glDrawElements(GL_TRIANGLES,
+                       command.indexCount,
+                       GL_UNSIGNED_INT,
+                       reinterpret_cast<const void *>(
+                           static_cast<std::uintptr_t>(command.firstIndex)
+                           * sizeof(GLuint)));
+        ++stats.draws;
+    }
+
+    for (auto &arena : m_arenas)
+        arena.commands.clear();
+    return stats;
+}
+
+}    // namespace apbr
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <format>
+#include <utility>
+
+#include <apbr/Logger.hpp>
+#include <apbr/Sampler.hpp>
+#include <apbr/Tile.hpp>
+#include <apbr/lowdiscrepancy.hpp>
+
+namespace {
+
+// `x` with `a * x = 1 (mod n)`, for coprime `a` and `n` (extended Euclid).
+std::uint64_t multiplicativeInverse(std::int64_t a, std::int64_t n)
+{
+    std::int64_t r0 = n, r1 = a % n;
+    std::int64_t s0 = 0, s1 = 1;
+    while (r1 != 0) {
+        const auto q = r0 / r1;
+        r0           = std::exchange(r1, r0 - q * r1);
+        s0           = std::exchange(s1, s0 - q * s1);
+    }
+    return static_cast<std::uint64_t>((s0 % n + n) % n);
+}
+
+// seeds the pixel sample's point order shuffle, kept apart from the per dimension seeds.
+constexpr std::uint64_t shuffleTag = 0x73687566;
+
+// all 24 orderings of the four quadrants of a Morton digit.
+constexpr auto          quadrantPermutations = [] {
+    std::array<std::array<std::uint8_t, 4>, 24> permutations {};
+    std::array<std::uint8_t, 4>                 order {0, 1, 2, 3};
+    for (auto &permutation : permutations) {
+        permutation = order;
+        std::next_permutation(order.begin(), order.end());
+    }
+    return permutations;
+}();
+
+}    // namespace
+
+namespace apbr {
+
+void IndependentSampler::startPixelSample(glm::ivec2 pixel,
+                                          int        sampleIndex,
+                                          int        dimension)
+{
+    m_rng = RNG {hash(pixel.x, pixel.y, m_seed)};
+    m_rng.advance(sampleIndex * 65536ll + dimension);
+}
+
+void StratifiedSampler::startPixelSample(glm::ivec2 pixel,
+                                         int        sampleIndex,
+                                         int        dimension)
+{
+    m_pixel       = pixel;
+    m_sampleIndex = sampleIndex;
+    m_dimension   = dimension;
+    m_rng         = RNG {hash(pixel.x, pixel.y, m_seed)};
+    m_rng.advance(sampleIndex * 65536ll + dimension);
+}
+
+std::uint32_t StratifiedSampler::stratum()
+{
+    const auto count = static_cast<std::uint32_t>(samplesPerPixel());
+    const auto seed  = hash(m_pixel.x, m_pixel.y, m_dimension, m_seed);
+    return permutationElement(static_cast<std::uint32_t>(m_sampleIndex) % count,
+                              count,
+                              static_cast<std::uint32_t>(seed));
+}
+
+float StratifiedSampler::get1D()
+{
+    const auto s     = stratum();
+    const auto delta = m_jitter ? m_rng.uniformFloat() : 0.5f;
+    ++m_dimension;
+    return std::min((s + delta) / samplesPerPixel(), oneMinusEpsilon);
+}
+
+glm::vec2 StratifiedSampler::get2D()
+{
+    const auto s  = stratum();
+    const auto x  = static_cast<int>(s) % m_xSamples;
+    const auto y  = static_cast<int>(s) / m_xSamples;
+    const auto dx = m_jitter ? m_rng.uniformFloat() : 0.5f;
+    const auto dy = m_jitter ? m_rng.uniformFloat() : 0.5f;
+    m_dimension += 2;
+    return {std::min((x + dx) / m_xSamples, oneMinusEpsilon),
+            std::min((y + dy) / m_ySamples, oneMinusEpsilon)};
+}
+
+HaltonSampler::HaltonSampler(int           samplesPerPixel,
+                             glm::ivec2    resolution,
+                             std::uint64_t seed)
+    : m_samplesPerPixel {samplesPerPixel},
+      m_seed {seed}
+{
+    for (int i = 0; i < 2; ++i) {
+        const auto    extent = std::clamp(resolution[i], 1, maxResolution);
+        std::uint64_t scale  = 1;
+        int           exponent = 0;
+        while (scale < static_cast<std::uint64_t>(extent)) {
+            scale *= primes[i];
+            ++exponent;
+        }
+        m_baseScales[i]    = scale;
+        m_baseExponents[i] = exponent;
+    }
+
+    m_multInverse[0] = multiplicativeInverse(
+        static_cast<std::int64_t>(m_baseScales[1]),
+        static_cast<std::int64_t>(m_baseScales[0]));
+    m_multInverse[1] = multiplicativeInverse(
+        static_cast<std::int64_t>(m_baseScales[0]),
+        static_cast<std::int64_t>(m_baseScales[1]));
+}
+
+void HaltonSampler::startPixelSample(glm::ivec2 pixel,
+                                     int        sampleIndex,
+                                     int        dimension)
+{
+    // the first dimensions, scaled by `m_baseScales`, repeat over blocks of that many pixels.
+    // Solve for the first index landing in `pixel` (Chinese remainder theorem); the pixel's
+    // later samples follow every `stride` indices.
+    const auto stride = m_baseScales[0] * m_baseScales[1];
+    m_haltonIndex     = 0;
+    if (stride > 1) {
+        for (int i = 0; i < 2; ++i) {
+            const auto offset = inverseRadicalInverse(
+                static_cast<std::uint64_t>(pixel[i] % maxResolution),
+                primes[i],
+                m_baseExponents[i]);
+            m_haltonIndex += offset * (stride / m_baseScales[i]) * m_multInverse[i];
+        }
+        m_haltonIndex %= stride;
+    }
+    m_haltonIndex += static_cast<std::uint64_t>(sampleIndex) * stride;
+    m_dimension = std::max(2, dimension);
+}
+
+glm::vec2 HaltonSampler::getPixel2D()
+{
+    // the digits that picked the pixel are dropped, what's left is the offset within it.
+    return {radicalInverse(0, m_haltonIndex >> m_baseExponents[0]),
+            radicalInverse(1, m_haltonIndex / m_baseScales[1])};
+}
+
+glm::vec2 HaltonSampler::get2D()
+{
+    const auto x = sampleDimension(m_dimension);
+    const auto y = sampleDimension(m_dimension + 1);
+    m_dimension += 2;
+    return {x, y};
+}
+
+float HaltonSampler::sampleDimension(int dimension) const
+{
+    // wrap around past the last prime, skipping the two pixel dimensions. The scramble still
+    // depends on the real dimension, so the repeats are not correlated.
+    const auto baseIndex =
+        dimension < primeCount ? dimension : 2 + (dimension - 2) % (primeCount - 2);
+    return owenScrambledRadicalInverse(
+        baseIndex,
+        m_haltonIndex,
+        static_cast<std::uint32_t>(hash(dimension, m_seed)));
+}
+
+void SobolSampler::startPixelSample(glm::ivec2 pixel,
+                                    int        sampleIndex,
+                                    int        dimension)
+{
+    m_pixelHash   = hash(pixel.x, pixel.y, m_seed);
+    m_sampleIndex = static_cast<std::uint32_t>(sampleIndex);
+    m_dimension   = dimension;
+}
+
+float SobolSampler::sampleDimension(int dimension) const
+{
+    // Owen scrambling the index (Burley, "Practical Hash-based Owen Scrambling") shuffles the
+    // point order but keeps aligned power of two blocks together, so prefixes stay stratified.
+    // Each pixel and each pass over the table gets its own order.
+    const auto chunk = dimension / sobolDimensions;
+    const auto index = owenScramble(
+        m_sampleIndex,
+        static_cast<std::uint32_t>(hash(m_pixelHash, chunk, shuffleTag)));
+    return sobolSample(dimension % sobolDimensions,
+                       index,
+                       static_cast<std::uint32_t>(hash(m_pixelHash, dimension)));
+}
+
+ZSobolSampler::ZSobolSampler(int           samplesPerPixel,
+                             glm::ivec2    resolution,
+                             std::uint64_t seed)
+    : m_seed {seed}
+{
+    const auto spp = static_cast<unsigned>(std::max(samplesPerPixel, 1));
+    if (!std::has_single_bit(spp)) {
+        logger.logWarn(std::format(
+            "apbr::ZSobolSampler: {} samples per pixel rounded up to {}.",
+            spp,
+            std::bit_ceil(spp)));
+    }
+    m_log2SamplesPerPixel = std::bit_width(std::bit_ceil(spp)) - 1;
+
+    const auto extent = std::bit_ceil(
+        static_cast<unsigned>(std::max({resolution.x, resolution.y, 1})));
+    const auto log2Resolution = std::bit_width(extent) - 1;
+    m_base4Digits             = log2Resolution + (m_log2SamplesPerPixel + 1) / 2;
+}
+
+void ZSobolSampler::startPixelSample(glm::ivec2 pixel,
+                                     int        sampleIndex,
+                                     int        dimension)
+{
+    const auto index = static_cast<std::uint32_t>(sampleIndex);
+    const auto mask  = (1u << m_log2SamplesPerPixel) - 1;
+
+    m_roundSeed      = hash(m_seed, index >> m_log2SamplesPerPixel);
+    m_mortonIndex    = (static_cast<std::uint64_t>(mortonEncode(pixel.x, pixel.y))
+                     << m_log2SamplesPerPixel)
+                  | (index & mask);
+    m_dimension = dimension;
+}
+
+std::uint64_t ZSobolSampler::sampleIndex() const
+{
+    // permute the base 4 digits of the Morton index, each by a permutation picked from the
+    // digits above it. Neighbouring pixels then take different quadrants of the sequence.
+    std::uint64_t index      = 0;
+    // an odd power of two leaves one base 2 digit at the bottom.
+    const bool    oddPower   = m_log2SamplesPerPixel & 1;
+    const int     lastDigit  = oddPower ? 1 : 0;
+    const auto    dimensionHash = 0x55555555ull * static_cast<std::uint64_t>(m_dimension);
+    for (int i = m_base4Digits - 1; i >= lastDigit; --i) {
+        const int  shift  = 2 * i - (oddPower ? 1 : 0);
+        const auto digit  = (m_mortonIndex >> shift) & 3;
+        const auto higher = m_mortonIndex >> (shift + 2);
+        const auto p      = (mixBits(higher ^ dimensionHash) >> 24) % 24;
+        index |= static_cast<std::uint64_t>(quadrantPermutations[p][digit]) << shift;
+    }
+    if (oddPower) {
+        const auto digit = m_mortonIndex & 1;
+        index |= digit ^ (mixBits((m_mortonIndex >> 1) ^ dimensionHash) & 1);
+    }
+    return index;
+}
+
+float ZSobolSampler::get1D()
+{
+    // the Sobol points are 32 bit; that covers 4096 x 4096 pixels at 256 samples.
+    const auto index = static_cast<std::uint32_t>(sampleIndex());
+    ++m_dimension;
+    return sobolSample(0,
+                       index,
+                       static_cast<std::uint32_t>(hash(m_dimension, m_roundSeed)));
+}
+
+glm::vec2 ZSobolSampler::get2D()
+{
+    const auto index = static_cast<std::uint32_t>(sampleIndex());
+    m_dimension += 2;
+    const auto seed = hash(m_dimension, m_roundSeed);
+    return {sobolSample(0, index, static_cast<std::uint32_t>(seed)),
+            sobolSample(1, index, static_cast<std::uint32_t>(seed >> 32))};
+}
+
+}    // namespace apbr
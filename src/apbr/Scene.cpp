@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <apbr/Scene.hpp>
+#include <apbr/TaskScheduler.hpp>
+#include <apbr/simd.hpp>
+
+namespace {
+
+namespace simd = apbr::simd;
+
+// levels with fewer nodes are composed on the calling thread.
+constexpr std::size_t parallelLevelSize = 8192;
+constexpr std::size_t grainSize         = 2048;
+
+}    // namespace
+
+namespace apbr {
+
+glm::mat4 Scene::load(const Planes &planes, std::size_t slot)
+{
+    glm::mat4 m;
+    for (int e = 0; e < 16; ++e)
+        m[e / 4][e % 4] = planes[e][slot];
+    return m;
+}
+
+void Scene::store(Planes &planes, std::size_t slot, const glm::mat4 &m)
+{
+    for (int e = 0; e < 16; ++e)
+        planes[e][slot] = m[e / 4][e % 4];
+}
+
+Scene::Node Scene::addNode(const glm::mat4 &local, Node parent)
+{
+    if (parent != none && parent >= m_slot.size())
+        throw std::runtime_error("apbr::Scene::addNode: no such parent.");
+
+    const auto node       = static_cast<Node>(m_slot.size());
+    const auto slot       = static_cast<std::uint32_t>(m_node.size());
+    const auto parentSlot = parent == none ? none : m_slot[parent];
+    const auto depth      = parent == none ? 0u : m_depth[parentSlot] + 1;
+
+    // appending keeps the order as long as the node sorts after the last slot.
+    if (slot > 0) {
+        const auto lastDepth = m_depth.back();
+        if (depth < lastDepth || (depth == lastDepth && parentSlot < m_parent.back()))
+            m_sorted = false;
+    }
+    if (m_sorted) {
+        if (depth + 1 == m_levels.size())
+            m_levels.push_back(slot + 1);
+        else
+            ++m_levels.back();
+    }
+
+    m_slot.push_back(slot);
+    m_node.push_back(node);
+    m_parent.push_back(parentSlot);
+    m_depth.push_back(depth);
+    m_dirty.push_back(1);
+    for (auto *planes : {&m_local, &m_world}) {
+        for (auto &plane : *planes)
+            plane.push_back(0.0f);
+    }
+    store(m_local, slot, local);
+    return node;
+}
+
+Scene::Node Scene::parent(Node node) const
+{
+    const auto parentSlot = m_parent[m_slot[node]];
+    return parentSlot == none ? none : m_node[parentSlot];
+}
+
+void Scene::setLocal(Node node, const glm::mat4 &local)
+{
+    const auto slot = m_slot[node];
+    store(m_local, slot, local);
+    m_dirty[slot] = 1;
+}
+
+void Scene::sort()
+{
+    const auto n = m_node.size();
+
+    // depth by depth, roots by node; every deeper level by the new slot of the parent, so
+    // siblings stay together and in the order they were added.
+    std::vector<std::uint32_t> order;    // old slots, in the new order
+    std::vector<std::uint32_t> newSlot(n);
+    order.reserve(n);
+    m_levels.assign(1, 0);
+
+    const auto maxDepth = *std::max_element(m_depth.begin(), m_depth.end());
+    std::vector<std::vector<std::uint32_t>> byDepth(maxDepth + 1);
+    for (Node node = 0; node < n; ++node)
+        byDepth[m_depth[m_slot[node]]].push_back(m_slot[node]);
+
+    for (auto &level : byDepth) {
+        std::stable_sort(level.begin(), level.end(), [&](auto a, auto b) {
+            return m_parent[a] != none && newSlot[m_parent[a]] < newSlot[m_parent[b]];
+        });
+        for (const auto slot : level) {
+            newSlot[slot] = static_cast<std::uint32_t>(order.size());
+            order.push_back(slot);
+        }
+        m_levels.push_back(order.size());
+    }
+
+    auto permute = [&](auto &values) {
+        auto old = values;
+        for (std::size_t i = 0; i < n; ++i)
+            values[i] = old[order[i]];
+    };
+    permute(m_node);
+    permute(m_depth);
+    permute(m_dirty);
+    permute(m_parent);
+    for (auto &parent : m_parent) {
+        if (parent != none)
+            parent = newSlot[parent];
+    }
+    for (auto *planes : {&m_local, &m_world}) {
+        for (auto &plane : *planes)
+            permute(plane);
+    }
+    for (std::size_t i = 0; i < n; ++i)
+        m_slot[m_node[i]] = static_cast<std::uint32_t>(i);
+
+    m_sorted = true;
+}
+
+std::size_t Scene::update()
+{
+    if (m_node.empty())
+        return 0;
+    if (!m_sorted)
+        sort();
+
+    // parents come first, so one pass spreads the flags down to whole subtrees.
+    const auto n = m_node.size();
+    for (auto slot = m_levels[1]; slot < n; ++slot)
+        m_dirty[slot] |= m_dirty[m_parent[slot]];
+    const auto updated =
+        static_cast<std::size_t>(std::count(m_dirty.begin(), m_dirty.end(), 1));
+
+    for (std::size_t slot = 0; slot < m_levels[1]; ++slot) {
+        if (!m_dirty[slot])
+            continue;
+        for (int e = 0; e < 16; ++e)
+            m_world[e][slot] = m_local[e][slot];
+    }
+
+    auto &scheduler = TaskScheduler::global();
+    for (std::size_t depth = 1; depth + 1 < m_levels.size(); ++depth) {
+        const auto first = m_levels[depth];
+        const auto last  = m_levels[depth + 1];
+        if (last - first < parallelLevelSize) {
+            composeRange(first, last);
+            continue;
+        }
+        // split in whole groups of `simd::width` nodes, so only the last chunk has a partial
+        // group.
+        const auto groups  = (last - first + simd::width - 1) / simd::width;
+        auto       compose = [&](std::size_t begin, std::size_t end) {
+            composeRange(first + begin * simd::width,
+                         std::min(first + end * simd::width, last));
+        };
+        scheduler.parallelFor(0, groups, grainSize / simd::width, compose);
+    }
+
+    std::fill(m_dirty.begin(), m_dirty.end(), 0);
+    return updated;
+}
+
+void Scene::composeRange(std::size_t first, std::size_t last)
+{
+    for (auto begin = first; begin < last; begin += simd::width) {
+        const auto count = static_cast<int>(std::min<std::size_t>(simd::width, last - begin));
+        if (std::none_of(&m_dirty[begin], &m_dirty[begin] + count, [](auto d) { return d; }))
+            continue;
+
+        // gather the parents' world transforms; the lanes past `count` repeat the last node.
+        // Clean nodes sharing a group with dirty ones are recomputed too, to the same result.
+        float parent[16][simd::width];
+        for (int lane = 0; lane < simd::width; ++lane) {
+            const auto p = m_parent[begin + std::min(lane, count - 1)];
+            for (int e = 0; e < 16; ++e)
+                parent[e][lane] = m_world[e][p];
+        }
+
+        simd::vfloat p[16];
+        for (int e = 0; e < 16; ++e)
+            p[e] = simd::load(parent[e]);
+
+        // world = parent * local, a column of the local transform at a time.
+        for (int c = 0; c < 4; ++c) {
+            simd::vfloat l[4];
+            for (int k = 0; k < 4; ++k)
+                l[k] = simd::loadPartial(&m_local[4 * c + k][begin], count);
+            for (int r = 0; r < 4; ++r) {
+                auto sum = p[r] * l[0];
+                sum      = simd::fmadd(p[4 + r], l[1], sum);
+                sum      = simd::fmadd(p[8 + r], l[2], sum);
+                sum      = simd::fmadd(p[12 + r], l[3], sum);
+                simd::storePartial(&m_world[4 * c + r][begin], sum, count);
+            }
+        }
+    }
+}
+
+}    // namespace apbr
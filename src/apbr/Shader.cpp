@@ -41,26 +41,35 @@ Shader::Shader(Shader::Type type)
 {
 }
 
-Shader::Shader(Type type, const std::string& source) : Shader {type}
+Shader::Shader(Type type, std::string_view source) : Shader {type}
 {
     this->compile(source);
 }
 
-Shader Shader::from_file(Shader::Type type, const std::string &filepath)
+Shader Shader::from_file(Shader::Type               type,
+                         const std::string         &filepath,
+                         std::pmr::memory_resource *memory)
 {
-    std::ifstream sourceStream(filepath);
+    // unbuffered and opened at the end: the size is known up front and the source is read
+    // with a single call, instead of growing a string one character at a time.
+    std::ifstream sourceStream;
+    sourceStream.rdbuf()->pubsetbuf(nullptr, 0);
+    sourceStream.open(filepath, std::ios::binary | std::ios::ate);
     if (!sourceStream) {
         logger.logError(
             std::format("Shader file target `{}` could not be read.",
                         filepath));
     }
 
-    std::string source;
-    std::copy(std::istreambuf_iterator<char>(sourceStream),
-              std::istreambuf_iterator<char>(),
-              std::back_inserter(source));
+    std::pmr::string source {memory};
+    if (const auto size = sourceStream.tellg(); size > 0) {
+        source.resize(static_cast<std::size_t>(size));
+        sourceStream.seekg(0);
+        sourceStream.read(source.data(), size);
+        source.resize(static_cast<std::size_t>(sourceStream.gcount()));
+    }
 
-    return Shader {type, source.c_str()};
+    return Shader {type, source};
 }
 
 bool Shader::logCompileStatus() const
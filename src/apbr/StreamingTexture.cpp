@@ -0,0 +1,132 @@
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <apbr/StreamingTexture.hpp>
+#include <apbr/Logger.hpp>
+
+namespace apbr {
+
+StreamingTexture::StreamingTexture(int width, int height)
+    : m_width {width},
+      m_height {height}
+{
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // half floats keep the HDR range for the tone mapping in the fragment shader.
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_RGB16F,
+                 m_width,
+                 m_height,
+                 0,
+                 GL_RGB,
+                 GL_FLOAT,
+                 nullptr);
+
+    const auto size = static_cast<GLsizeiptr>(3 * sizeof(float)) * m_width
+                    * m_height;
+    glGenBuffers(2, m_pbo);
+    for (const auto pbo : m_pbo) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+
+    // `glTexImage2D` left the contents undefined; show black until the first update.
+    if (auto *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                     0,
+                                     size,
+                                     GL_MAP_WRITE_BIT
+                                         | GL_MAP_INVALIDATE_BUFFER_BIT)) {
+        std::memset(dst, 0, static_cast<std::size_t>(size));
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0,
+                        0,
+                        0,
+                        m_width,
+                        m_height,
+                        GL_RGB,
+                        GL_FLOAT,
+                        nullptr);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+StreamingTexture::~StreamingTexture()
+{
+    glDeleteBuffers(2, m_pbo);
+    glDeleteTextures(1, &m_texture);
+}
+
+void StreamingTexture::update(std::span<const float> rgb)
+{
+    const auto size = static_cast<GLsizeiptr>(3 * sizeof(float)) * m_width
+                    * m_height;
+    if (rgb.size_bytes() < static_cast<std::size_t>(size)) {
+        logger.logError("apbr::StreamingTexture::update: image too small.");
+        return;
+    }
+
+    // nothing to show yet, so there is nothing to hide the latency behind either.
+    if (m_empty) {
+        glBindTexture(GL_TEXTURE_2D, m_texture);
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0,
+                        0,
+                        0,
+                        m_width,
+                        m_height,
+                        GL_RGB,
+                        GL_FLOAT,
+                        rgb.data());
+        m_empty = false;
+        return;
+    }
+
+    flush();
+
+    // fill the other buffer. Orphaning it first means the driver never has to wait for a
+    // copy that may still be reading it.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[m_index]);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    if (auto *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                     0,
+                                     size,
+                                     GL_MAP_WRITE_BIT
+                                         | GL_MAP_INVALIDATE_BUFFER_BIT)) {
+        std::memcpy(dst, rgb.data(), static_cast<std::size_t>(size));
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        m_index   ^= 1;
+        m_pending  = true;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void StreamingTexture::flush()
+{
+    if (!m_pending)
+        return;
+
+    // with a PBO bound the copy is asynchronous and `nullptr` is an offset into the buffer.
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[m_index ^ 1]);
+    glTexSubImage2D(GL_TEXTURE_2D,
+                    0,
+                    0,
+                    0,
+                    m_width,
+                    m_height,
+                    GL_RGB,
+                    GL_FLOAT,
+                    nullptr);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_pending = false;
+}
+
+}    // namespace apbr
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <format>
+#include <thread>
+
+#include <apbr/TaskScheduler.hpp>
+#include <apbr/Logger.hpp>
+
+namespace {
+
+struct ThreadSlot
+{
+    const apbr::TaskScheduler *scheduler = nullptr;
+    unsigned                   index     = 0;
+};
+
+// which scheduler (if any) owns the calling thread, and its worker index there.
+thread_local ThreadSlot currentThread;
+
+}    // namespace
+
+namespace apbr {
+
+TaskScheduler::TaskScheduler(unsigned workerCount)
+{
+    m_queues.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; ++i)
+        m_queues.push_back(std::make_unique<WorkQueue>());
+
+    m_threads.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; ++i)
+        m_threads.emplace_back([this, i] { workerLoop(i); });
+
+    logger.log(std::format("apbr::TaskScheduler started {} workers.",
+                           workerCount));
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard lock {m_sleepMutex};
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+TaskScheduler &TaskScheduler::global()
+{
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+
+unsigned TaskScheduler::defaultWorkerCount()
+{
+    // the thread waiting on the results is the remaining core.
+    const auto cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 1;
+}
+
+unsigned TaskScheduler::threadIndex() const
+{
+    if (currentThread.scheduler == this)
+        return currentThread.index;
+    return static_cast<unsigned>(m_queues.size());
+}
+
+bool TaskScheduler::hasLocalWork() const
+{
+    // racy on purpose: it only steers how eagerly work gets split.
+    auto &queue = currentThread.scheduler == this
+                    ? *m_queues[currentThread.index]
+                    : m_shared;
+    std::lock_guard lock {queue.mutex};
+    return !queue.tasks.empty();
+}
+
+void TaskScheduler::run(TaskGroup &group, Task task)
+{
+    group.m_pending.fetch_add(1, std::memory_order_relaxed);
+    push(QueuedTask {std::move(task), &group});
+}
+
+void TaskScheduler::push(QueuedTask task)
+{
+    auto &queue = currentThread.scheduler == this
+                    ? *m_queues[currentThread.index]
+                    : m_shared;
+    {
+        std::lock_guard lock {queue.mutex};
+        queue.tasks.push_back(std::move(task));
+    }
+    // sequentially consistent with the `m_idle` update in `workerLoop`, so either the worker
+    // sees the task before sleeping or we see the worker and wake it.
+    m_queued.fetch_add(1);
+
+    if (m_idle.load() > 0) {
+        // taking the lock orders this with a worker that is about to sleep.
+        { std::lock_guard lock {m_sleepMutex}; }
+        m_wake.notify_one();
+    }
+}
+
+bool TaskScheduler::tryRunOne(const TaskGroup *group)
+{
+    const bool isWorker = currentThread.scheduler == this;
+    const auto self     = isWorker ? currentThread.index : 0u;
+
+    if (!isWorker) {
+        // only the oldest task of `group` still in the shared queue; whatever the workers
+        // split off of it is left to them.
+        QueuedTask task;
+        {
+            std::lock_guard lock {m_shared.mutex};
+            auto           &tasks = m_shared.tasks;
+            const auto      it    = std::find_if(
+                tasks.begin(),
+                tasks.end(),
+                [group](const QueuedTask &queued) { return queued.group == group; });
+            if (it == tasks.end())
+                return false;
+            task = std::move(*it);
+            tasks.erase(it);
+        }
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        execute(task);
+        return true;
+    }
+
+    auto pop = [&](WorkQueue &queue, bool back, QueuedTask &out) {
+        std::lock_guard lock {queue.mutex};
+        if (queue.tasks.empty())
+            return false;
+        if (back) {
+            out = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            out = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        return true;
+    };
+
+    QueuedTask task;
+    bool       found = pop(*m_queues[self], true, task);
+    // steal the oldest task of the others, starting after ourselves to spread the thieves.
+    const auto count = m_queues.size();
+    for (std::size_t i = 1; !found && i < count; ++i)
+        found = pop(*m_queues[(self + i) % count], false, task);
+    if (!found)
+        found = pop(m_shared, false, task);
+    if (!found)
+        return false;
+
+    m_queued.fetch_sub(1, std::memory_order_relaxed);
+    execute(task);
+    return true;
+}
+
+void TaskScheduler::execute(QueuedTask &task)
+{
+    try {
+        task.fn();
+    } catch (...) {
+        std::lock_guard lock {task.group->m_errorMutex};
+        if (!task.group->m_error)
+            task.group->m_error = std::current_exception();
+    }
+    task.group->m_pending.fetch_sub(1, std::memory_order_release);
+}
+
+void TaskScheduler::wait(TaskGroup &group)
+{
+    while (!group.done()) {
+        if (!tryRunOne(&group))
+            std::this_thread::yield();
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard lock {group.m_errorMutex};
+        std::swap(error, group.m_error);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void TaskScheduler::workerLoop(unsigned index)
+{
+    currentThread = ThreadSlot {this, index};
+
+    while (true) {
+        if (tryRunOne())
+            continue;
+
+        std::unique_lock lock {m_sleepMutex};
+        m_idle.fetch_add(1);
+        m_wake.wait(lock, [this] { return m_stop || m_queued.load() > 0; });
+        m_idle.fetch_sub(1);
+        if (m_stop)
+            return;
+    }
+}
+
+}    // namespace apbr
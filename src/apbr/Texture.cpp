@@ -0,0 +1,477 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#include <apbr/Logger.hpp>
+#include <apbr/TaskScheduler.hpp>
+#include <apbr/Texture.hpp>
+#include <apbr/Tile.hpp>
+
+namespace {
+
+using apbr::Texture;
+using apbr::TextureBlock;
+
+constexpr char cacheMagic[8] = {'A', 'P', 'B', 'R', 'T', 'E', 'X', '1'};
+
+// what `writeCache` puts before the blocks. Native byte order: cache files are meant for the
+// machine that wrote them.
+struct CacheHeader
+{
+    char          magic[8];
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t levels;
+    std::uint32_t srgb;
+};
+
+// handed out for blocks that failed to page in: transparent black.
+const TextureBlock missingBlock {};
+
+float              srgbToLinear(float v)
+{
+    return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+}
+
+float linearToSrgb(float v)
+{
+    return v <= 0.0031308f ? v * 12.92f
+                           : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+}
+
+const auto srgbTable = [] {
+    std::array<float, 256> table;
+    for (int i = 0; i < 256; ++i)
+        table[i] = srgbToLinear(i / 255.0f);
+    return table;
+}();
+
+std::uint32_t toByte(float v)
+{
+    return static_cast<std::uint32_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+std::uint32_t pack(const glm::vec4 &c, bool srgb)
+{
+    auto encode = [srgb](float v) { return toByte(srgb ? linearToSrgb(v) : v); };
+    return encode(c.x) | (encode(c.y) << 8) | (encode(c.z) << 16) | (toByte(c.w) << 24);
+}
+
+glm::vec4 unpack(std::uint32_t v, bool srgb)
+{
+    auto decode = [srgb](std::uint32_t byte) {
+        return srgb ? srgbTable[byte] : byte / 255.0f;
+    };
+    return {decode(v & 0xff),
+            decode((v >> 8) & 0xff),
+            decode((v >> 16) & 0xff),
+            (v >> 24) / 255.0f};
+}
+
+// offset of texel (x, y) inside its block.
+std::uint32_t texelOffset(int x, int y)
+{
+    constexpr auto mask = static_cast<std::uint32_t>(Texture::blockSize - 1);
+    return apbr::mortonEncode(static_cast<std::uint32_t>(x) & mask,
+                              static_cast<std::uint32_t>(y) & mask);
+}
+
+int wrap(int v, int n)
+{
+    v %= n;
+    return v < 0 ? v + n : v;
+}
+
+// Gaussian EWA weights over the squared ellipse radius in [0, 1), falling to zero at the edge.
+constexpr int ewaTableSize = 128;
+const auto    ewaWeights   = [] {
+    constexpr float           alpha = 2.0f;
+    std::array<float, ewaTableSize> table;
+    for (int i = 0; i < ewaTableSize; ++i) {
+        const auto r2 = static_cast<float>(i) / (ewaTableSize - 1);
+        table[i]      = std::exp(-alpha * r2) - std::exp(-alpha);
+    }
+    return table;
+}();
+
+}    // namespace
+
+namespace apbr {
+
+struct Texture::PagedFile
+{
+    std::mutex        mutex;    // guards `stream`
+    std::ifstream     stream;
+    std::streamoff    dataOffset = 0;
+    std::uint64_t     source     = 0;
+    std::atomic<bool> reported {false};
+};
+
+class Texture::Fetch
+{
+public:
+    explicit Fetch(const Texture &texture) : m_texture {texture} {}
+
+    const TextureBlock &block(std::size_t index)
+    {
+        if (index == m_index)
+            return *m_block;
+
+        m_index = index;
+        if (!m_texture.paged()) {
+            m_block = &m_texture.m_blocks[index];
+            return *m_block;
+        }
+
+        auto &file = *m_texture.m_file;
+        m_keep     = m_texture.m_cache->block(
+            file.source,
+            index,
+            [&](TextureBlock &block) {
+                std::lock_guard lock {file.mutex};
+                file.stream.clear();
+                file.stream.seekg(file.dataOffset
+                                  + static_cast<std::streamoff>(
+                                      index * sizeof(TextureBlock)));
+                file.stream.read(reinterpret_cast<char *>(block.texels),
+                                 sizeof(TextureBlock));
+                return static_cast<bool>(file.stream);
+            });
+        if (!m_keep && !file.reported.exchange(true))
+            logger.logError("apbr::Texture: failed to page in a block from its cache file.");
+        m_block = m_keep ? m_keep.get() : &missingBlock;
+        return *m_block;
+    }
+
+private:
+    const Texture                      &m_texture;
+    std::size_t                         m_index = ~std::size_t {0};
+    const TextureBlock                 *m_block = nullptr;
+    // keeps a paged block alive even if the cache evicts it meanwhile.
+    std::shared_ptr<const TextureBlock> m_keep;
+};
+
+Texture::Texture(int                           width,
+                 int                           height,
+                 int                           channels,
+                 std::span<const std::uint8_t> pixels,
+                 bool                          srgb)
+    : m_srgb {srgb}
+{
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4
+        || pixels.size() < static_cast<std::size_t>(width) * height * channels) {
+        throw std::runtime_error(std::format(
+            "apbr::Texture: bad image ({}x{}, {} channels, {} bytes).",
+            width,
+            height,
+            channels,
+            pixels.size()));
+    }
+
+    m_blocks.resize(setLevels(width, height));
+
+    auto &scheduler = TaskScheduler::global();
+    scheduler.parallelFor(0, height, 16, [&](std::size_t first, std::size_t last) {
+        for (auto y = static_cast<int>(first); y < static_cast<int>(last); ++y) {
+            for (int x = 0; x < width; ++x) {
+                const auto   *p = &pixels[(static_cast<std::size_t>(y) * width + x)
+                                        * channels];
+                std::uint32_t r = p[0], g = p[0], b = p[0], a = 255;
+                if (channels == 2)
+                    a = p[1];
+                if (channels >= 3) {
+                    g = p[1];
+                    b = p[2];
+                }
+                if (channels == 4)
+                    a = p[3];
+                m_blocks[blockIndex(0, x, y)].texels[texelOffset(x, y)] =
+                    r | (g << 8) | (b << 16) | (a << 24);
+            }
+        }
+    });
+
+    for (int level = 1; level < levels(); ++level)
+        buildLevel(level);
+}
+
+std::size_t Texture::setLevels(int width, int height)
+{
+    m_levels.clear();
+    std::size_t blocks = 0;
+    for (;;) {
+        const auto blocksX = (width + blockSize - 1) / blockSize;
+        const auto blocksY = (height + blockSize - 1) / blockSize;
+        m_levels.push_back(Level {width, height, blocksX, blocks});
+        blocks += static_cast<std::size_t>(blocksX) * blocksY;
+        if (width == 1 && height == 1)
+            return blocks;
+        width  = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+}
+
+std::size_t Texture::blockIndex(int level, int x, int y) const
+{
+    const auto &l = m_levels[level];
+    return l.firstBlock + static_cast<std::size_t>(y / blockSize) * l.blocksX
+         + x / blockSize;
+}
+
+void Texture::buildLevel(int level)
+{
+    // 2 x 2 box filter in linear space. Odd sizes drop the last row or column.
+    const auto &source = m_levels[level - 1];
+    const auto &target = m_levels[level];
+
+    auto        texelAt = [&](int l, int x, int y) {
+        return unpack(m_blocks[blockIndex(l, x, y)].texels[texelOffset(x, y)], m_srgb);
+    };
+
+    TaskScheduler::global().parallelFor(
+        0,
+        target.height,
+        16,
+        [&](std::size_t first, std::size_t last) {
+            for (auto y = static_cast<int>(first); y < static_cast<int>(last); ++y) {
+                for (int x = 0; x < target.width; ++x) {
+                    const auto x0 = std::min(2 * x, source.width - 1);
+                    const auto x1 = std::min(2 * x + 1, source.width - 1);
+                    const auto y0 = std::min(2 * y, source.height - 1);
+                    const auto y1 = std::min(2 * y + 1, source.height - 1);
+                    const auto average =
+                        (texelAt(level - 1, x0, y0) + texelAt(level - 1, x1, y0)
+                         + texelAt(level - 1, x0, y1) + texelAt(level - 1, x1, y1))
+                        * 0.25f;
+                    m_blocks[blockIndex(level, x, y)].texels[texelOffset(x, y)] =
+                        pack(average, m_srgb);
+                }
+            }
+        });
+}
+
+std::optional<Texture>
+Texture::fromCache(const std::filesystem::path  &path,
+                   std::shared_ptr<TextureCache> cache)
+{
+    if (!cache) {
+        logger.logError("apbr::Texture::fromCache: no cache to page into.");
+        return std::nullopt;
+    }
+
+    auto file = std::make_shared<PagedFile>();
+    file->stream.open(path, std::ios::binary);
+    CacheHeader header;
+    if (!file->stream.read(reinterpret_cast<char *>(&header), sizeof(header))
+        || !std::equal(std::begin(cacheMagic), std::end(cacheMagic), header.magic)
+        || header.width == 0 || header.height == 0) {
+        logger.logError(std::format("apbr::Texture::fromCache: `{}` is not a texture cache.",
+                                    path.string()));
+        return std::nullopt;
+    }
+
+    Texture texture;
+    texture.m_srgb    = header.srgb != 0;
+    const auto blocks = texture.setLevels(static_cast<int>(header.width),
+                                          static_cast<int>(header.height));
+
+    std::error_code error;
+    const auto      size = std::filesystem::file_size(path, error);
+    if (error || header.levels != texture.m_levels.size()
+        || size < sizeof(header) + blocks * sizeof(TextureBlock)) {
+        logger.logError(std::format("apbr::Texture::fromCache: `{}` is truncated or corrupt.",
+                                    path.string()));
+        return std::nullopt;
+    }
+
+    file->dataOffset = sizeof(header);
+    file->source     = cache->newSource();
+    texture.m_file   = std::move(file);
+    texture.m_cache  = std::move(cache);
+    return texture;
+}
+
+bool Texture::writeCache(const std::filesystem::path &path) const
+{
+    if (paged()) {
+        logger.logError("apbr::Texture::writeCache: the texture is paged already.");
+        return false;
+    }
+
+    CacheHeader header;
+    std::copy(std::begin(cacheMagic), std::end(cacheMagic), header.magic);
+    header.width  = static_cast<std::uint32_t>(width());
+    header.height = static_cast<std::uint32_t>(height());
+    header.levels = static_cast<std::uint32_t>(levels());
+    header.srgb   = m_srgb;
+
+    std::ofstream stream {path, std::ios::binary};
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char *>(m_blocks.data()),
+                 static_cast<std::streamsize>(m_blocks.size() * sizeof(TextureBlock)));
+    if (!stream) {
+        logger.logError(std::format("apbr::Texture::writeCache: failed to write `{}`.",
+                                    path.string()));
+        return false;
+    }
+    return true;
+}
+
+glm::vec4 Texture::texel(int level, int x, int y) const
+{
+    Fetch fetch {*this};
+    return texel(fetch, std::clamp(level, 0, levels() - 1), x, y);
+}
+
+glm::vec4 Texture::texel(Fetch &fetch, int level, int x, int y) const
+{
+    const auto &l = m_levels[level];
+    x             = wrap(x, l.width);
+    y             = wrap(y, l.height);
+    return unpack(fetch.block(blockIndex(level, x, y)).texels[texelOffset(x, y)],
+                  m_srgb);
+}
+
+glm::vec4 Texture::bilerp(Fetch &fetch, int level, glm::vec2 st) const
+{
+    const auto &l  = m_levels[level];
+    const auto  x  = st.x * l.width - 0.5f;
+    const auto  y  = st.y * l.height - 0.5f;
+    const auto  x0 = static_cast<int>(std::floor(x));
+    const auto  y0 = static_cast<int>(std::floor(y));
+    const auto  dx = x - x0;
+    const auto  dy = y - y0;
+    return (1 - dx) * (1 - dy) * texel(fetch, level, x0, y0)
+         + dx * (1 - dy) * texel(fetch, level, x0 + 1, y0)
+         + (1 - dx) * dy * texel(fetch, level, x0, y0 + 1)
+         + dx * dy * texel(fetch, level, x0 + 1, y0 + 1);
+}
+
+glm::vec4 Texture::ewa(Fetch    &fetch,
+                       int       level,
+                       glm::vec2 st,
+                       glm::vec2 dst0,
+                       glm::vec2 dst1) const
+{
+    if (level >= levels())
+        return texel(fetch, levels() - 1, 0, 0);
+
+    // into texel units of this level
+    const auto &l      = m_levels[level];
+    const auto  scale  = glm::vec2 {static_cast<float>(l.width),
+                                   static_cast<float>(l.height)};
+    const auto  center = st * scale - glm::vec2 {0.5f};
+    dst0 *= scale;
+    dst1 *= scale;
+
+    // implicit ellipse A s^2 + B s t + C t^2 = 1 spanned by the two axes. The `+ 1`s keep it at
+    // least a texel wide.
+    auto  A    = dst0.y * dst0.y + dst1.y * dst1.y + 1.0f;
+    auto  B    = -2.0f * (dst0.x * dst0.y + dst1.x * dst1.y);
+    auto  C    = dst0.x * dst0.x + dst1.x * dst1.x + 1.0f;
+    const auto invF = 1.0f / (A * C - B * B * 0.25f);
+    A *= invF;
+    B *= invF;
+    C *= invF;
+
+    // bounding box of the ellipse
+    const auto det    = 4.0f * A * C - B * B;
+    const auto invDet = 1.0f / det;
+    const auto uSqrt  = std::sqrt(std::max(0.0f, det * C));
+    const auto vSqrt  = std::sqrt(std::max(0.0f, det * A));
+    const auto s0     = static_cast<int>(std::ceil(center.x - 2.0f * invDet * uSqrt));
+    const auto s1     = static_cast<int>(std::floor(center.x + 2.0f * invDet * uSqrt));
+    const auto t0     = static_cast<int>(std::ceil(center.y - 2.0f * invDet * vSqrt));
+    const auto t1     = static_cast<int>(std::floor(center.y + 2.0f * invDet * vSqrt));
+
+    glm::vec4  sum {0.0f};
+    float      sumWeights = 0.0f;
+    for (int it = t0; it <= t1; ++it) {
+        const auto tt = it - center.y;
+        for (int is = s0; is <= s1; ++is) {
+            const auto ss = is - center.x;
+            const auto r2 = A * ss * ss + B * ss * tt + C * tt * tt;
+            if (r2 < 1.0f) {
+                const auto index =
+                    std::min(static_cast<int>(r2 * ewaTableSize), ewaTableSize - 1);
+                const auto weight = ewaWeights[index];
+                sum += weight * texel(fetch, level, is, it);
+                sumWeights += weight;
+            }
+        }
+    }
+    return sumWeights > 0.0f ? sum / sumWeights : bilerp(fetch, level, st);
+}
+
+glm::vec4 Texture::lookup(const TextureFootprint &footprint) const
+{
+    Fetch fetch {*this};
+
+    // wrap first, so huge coordinates don't overflow the texel indices.
+    auto  st = footprint.st;
+    if (!std::isfinite(st.x) || !std::isfinite(st.y))
+        st = glm::vec2 {0.0f};
+    st -= glm::vec2 {std::floor(st.x), std::floor(st.y)};
+
+    auto       dst0      = footprint.dstdx;
+    auto       dst1      = footprint.dstdy;
+    // level 0 texels per unit of texture coordinates, along the larger side.
+    const auto texelRate = static_cast<float>(std::max(width(), height()));
+
+    if (m_filter != TextureFilter::EWA) {
+        // a square filter as wide as the larger axis of the footprint
+        const auto filterWidth = 2.0f * std::max({std::abs(dst0.x),
+                                                  std::abs(dst0.y),
+                                                  std::abs(dst1.x),
+                                                  std::abs(dst1.y)});
+        const auto level = std::log2(std::max(filterWidth * texelRate, 1e-8f));
+        if (level >= levels() - 1)
+            return texel(fetch, levels() - 1, 0, 0);
+        const auto iLevel = std::max(0, static_cast<int>(std::floor(level)));
+
+        switch (m_filter) {
+        case TextureFilter::Point: {
+            const auto &l = m_levels[iLevel];
+            return texel(fetch,
+                         iLevel,
+                         static_cast<int>(st.x * l.width),
+                         static_cast<int>(st.y * l.height));
+        }
+        case TextureFilter::Bilinear:
+            return bilerp(fetch, iLevel, st);
+        default:
+            if (level <= 0.0f)
+                return bilerp(fetch, 0, st);
+            const auto delta = level - static_cast<float>(iLevel);
+            return (1.0f - delta) * bilerp(fetch, iLevel, st)
+                 + delta * bilerp(fetch, iLevel + 1, st);
+        }
+    }
+
+    // EWA: pick the level from the minor axis, so it spans about a texel there, and let the
+    // ellipse cover the major axis.
+    if (glm::dot(dst0, dst0) < glm::dot(dst1, dst1))
+        std::swap(dst0, dst1);
+    const auto longer  = glm::length(dst0);
+    auto       shorter = glm::length(dst1);
+    if (shorter > 0.0f && shorter * m_maxAnisotropy < longer) {
+        const auto scale = longer / (shorter * m_maxAnisotropy);
+        dst1 *= scale;
+        shorter *= scale;
+    }
+    if (shorter == 0.0f)
+        return bilerp(fetch, 0, st);
+
+    const auto lod   = std::max(0.0f, std::log2(shorter * texelRate));
+    const auto iLod  = static_cast<int>(std::floor(lod));
+    const auto delta = lod - static_cast<float>(iLod);
+    return (1.0f - delta) * ewa(fetch, iLod, st, dst0, dst1)
+         + delta * ewa(fetch, iLod + 1, st, dst0, dst1);
+}
+
+}    // namespace apbr
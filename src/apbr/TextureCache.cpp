@@ -0,0 +1,80 @@
+#include <algorithm>
+
+#include <apbr/TextureCache.hpp>
+#include <apbr/rng.hpp>
+
+namespace apbr {
+
+TextureCache::TextureCache(std::size_t capacityBytes)
+    : m_shardCapacity {std::max<std::size_t>(
+          1,
+          capacityBytes / (sizeof(TextureBlock) * shardCount))},
+      m_shards(shardCount)
+{
+}
+
+std::uint64_t TextureCache::hits() const
+{
+    std::uint64_t total = 0;
+    for (const auto &shard : m_shards) {
+        std::lock_guard lock {shard.mutex};
+        total += shard.hits;
+    }
+    return total;
+}
+
+std::uint64_t TextureCache::misses() const
+{
+    std::uint64_t total = 0;
+    for (const auto &shard : m_shards) {
+        std::lock_guard lock {shard.mutex};
+        total += shard.misses;
+    }
+    return total;
+}
+
+std::uint64_t TextureCache::newSource()
+{
+    std::lock_guard lock {m_sourceMutex};
+    return m_nextSource++;
+}
+
+std::shared_ptr<const TextureBlock>
+TextureCache::block(std::uint64_t source, std::uint64_t index, const Loader &load)
+{
+    // 40 bits of block index are 4 PiB of texels per source.
+    const auto key   = (source << 40) | index;
+    auto      &shard = m_shards[mixBits(key) % shardCount];
+
+    {
+        std::lock_guard lock {shard.mutex};
+        if (auto it = shard.entries.find(key); it != shard.entries.end()) {
+            shard.order.splice(shard.order.begin(),
+                               shard.order,
+                               it->second.position);
+            ++shard.hits;
+            return it->second.block;
+        }
+        ++shard.misses;
+    }
+
+    // load without holding the lock; two threads missing on the same block both read it, and
+    // the second insert below keeps the first copy.
+    auto block = std::make_shared<TextureBlock>();
+    if (!load(*block))
+        return nullptr;
+
+    std::lock_guard lock {shard.mutex};
+    if (auto it = shard.entries.find(key); it != shard.entries.end())
+        return it->second.block;
+
+    if (shard.entries.size() >= m_shardCapacity) {
+        shard.entries.erase(shard.order.back());
+        shard.order.pop_back();
+    }
+    shard.order.push_front(key);
+    shard.entries.emplace(key, Shard::Entry {block, shard.order.begin()});
+    return block;
+}
+
+}    // namespace apbr
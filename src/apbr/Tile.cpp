@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#include <apbr/Tile.hpp>
+
+namespace {
+
+// position `d` along the Hilbert curve filling an `n` x `n` grid, `n` a power of two.
+void hilbertToXY(std::uint32_t n, std::uint32_t d, std::uint32_t &x, std::uint32_t &y)
+{
+    x = y = 0;
+    for (std::uint32_t s = 1; s < n; s *= 2) {
+        const auto rx = 1 & (d / 2);
+        const auto ry = 1 & (d ^ rx);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+        x += s * rx;
+        y += s * ry;
+        d /= 4;
+    }
+}
+
+}    // namespace
+
+namespace apbr {
+
+std::vector<Tile>
+makeTiles(int width, int height, int tileSize, TileOrder order)
+{
+    std::vector<Tile> tiles;
+    if (width <= 0 || height <= 0)
+        return tiles;
+
+    tileSize          = std::max(tileSize, 1);
+    const auto countX = static_cast<std::uint32_t>((width + tileSize - 1) / tileSize);
+    const auto countY = static_cast<std::uint32_t>((height + tileSize - 1) / tileSize);
+    tiles.reserve(countX * countY);
+
+    auto emit = [&](std::uint32_t tx, std::uint32_t ty) {
+        const int x0 = static_cast<int>(tx) * tileSize;
+        const int y0 = static_cast<int>(ty) * tileSize;
+        tiles.push_back(Tile {x0,
+                              y0,
+                              std::min(x0 + tileSize, width),
+                              std::min(y0 + tileSize, height)});
+    };
+
+    switch (order) {
+    case TileOrder::Scanline:
+        for (std::uint32_t ty = 0; ty < countY; ++ty)
+            for (std::uint32_t tx = 0; tx < countX; ++tx)
+                emit(tx, ty);
+        break;
+    case TileOrder::Morton: {
+        std::vector<std::uint32_t> keys;
+        keys.reserve(countX * countY);
+        for (std::uint32_t ty = 0; ty < countY; ++ty)
+            for (std::uint32_t tx = 0; tx < countX; ++tx)
+                keys.push_back(mortonEncode(tx, ty));
+        std::sort(keys.begin(), keys.end());
+        for (const auto key : keys) {
+            // de-interleave
+            std::uint32_t tx = 0, ty = 0;
+            for (int bit = 0; bit < 16; ++bit) {
+                tx |= ((key >> (2 * bit)) & 1u) << bit;
+                ty |= ((key >> (2 * bit + 1)) & 1u) << bit;
+            }
+            emit(tx, ty);
+        }
+        break;
+    }
+    case TileOrder::Hilbert: {
+        const auto n = std::bit_ceil(std::max(countX, countY));
+        for (std::uint32_t d = 0; d < n * n; ++d) {
+            std::uint32_t tx, ty;
+            hilbertToXY(n, d, tx, ty);
+            if (tx < countX && ty < countY)
+                emit(tx, ty);
+        }
+        break;
+    }
+    }
+    return tiles;
+}
+
+Tile splitTile(Tile &tile)
+{
+    auto other = tile;
+    if (tile.width() >= tile.height()) {
+        tile.x1 = other.x0 = tile.x0 + tile.width() / 2;
+    } else {
+        tile.y1 = other.y0 = tile.y0 + tile.height() / 2;
+    }
+    return other;
+}
+
+}    // namespace apbr
@@ -0,0 +1,151 @@
+#include <vector>
+
+#include <apbr/Logger.hpp>
+#include <apbr/TriangleMesh.hpp>
+
+namespace {
+
+using apbr::RayPacket;
+namespace simd = apbr::simd;
+
+// Moller-Trumbore for one triangle against all rays of a packet.
+// Returns the bits of the lanes in `lanes` that hit closer than their `tMax`.
+std::uint32_t intersectPacket(const apbr::Triangle &tri,
+                              const RayPacket      &packet,
+                              std::uint32_t         lanes,
+                              simd::vfloat         &t,
+                              simd::vfloat         &b1,
+                              simd::vfloat         &b2)
+{
+    const auto e1 = tri.v1 - tri.v0;
+    const auto e2 = tri.v2 - tri.v0;
+
+    // broadcast helpers, the triangle is the same for all lanes.
+    auto       bc = [](float x) { return simd::broadcast(x); };
+
+    const auto dx = simd::load(packet.dx);
+    const auto dy = simd::load(packet.dy);
+    const auto dz = simd::load(packet.dz);
+
+    // p = cross(d, e2)
+    const auto px = dy * bc(e2.z) - dz * bc(e2.y);
+    const auto py = dz * bc(e2.x) - dx * bc(e2.z);
+    const auto pz = dx * bc(e2.y) - dy * bc(e2.x);
+    const auto det = px * bc(e1.x) + py * bc(e1.y) + pz * bc(e1.z);
+    const auto invDet = bc(1.0f) / det;
+
+    const auto sx = simd::load(packet.ox) - bc(tri.v0.x);
+    const auto sy = simd::load(packet.oy) - bc(tri.v0.y);
+    const auto sz = simd::load(packet.oz) - bc(tri.v0.z);
+    b1            = (sx * px + sy * py + sz * pz) * invDet;
+
+    // q = cross(s, e1)
+    const auto qx = sy * bc(e1.z) - sz * bc(e1.y);
+    const auto qy = sz * bc(e1.x) - sx * bc(e1.z);
+    const auto qz = sx * bc(e1.y) - sy * bc(e1.x);
+    b2            = (dx * qx + dy * qy + dz * qz) * invDet;
+    t             = (bc(e2.x) * qx + bc(e2.y) * qy + bc(e2.z) * qz) * invDet;
+
+    const auto zero = bc(0.0f);
+    const auto hit  = (simd::abs(det) > bc(1e-12f)) & (b1 >= zero)
+                   & (b2 >= zero) & (b1 + b2 <= bc(1.0f)) & (t > zero)
+                   & (t < simd::load(packet.tMax));
+    return simd::bits(hit) & lanes;
+}
+
+std::vector<apbr::Bounds3f> triangleBounds(const apbr::TriangleMesh &mesh)
+{
+    std::vector<apbr::Bounds3f> bounds;
+    bounds.reserve(mesh.triangleCount());
+    for (std::uint32_t i = 0; i < mesh.triangleCount(); ++i)
+        bounds.push_back(mesh.triangle(i).bounds());
+    return bounds;
+}
+
+}    // namespace
+
+namespace apbr {
+
+TriangleMesh::TriangleMesh(std::vector<glm::vec3>     positions,
+                           std::vector<std::uint32_t> indices,
+                           std::vector<glm::vec2>     uvs)
+    : m_positions {std::move(positions)},
+      m_indices {std::move(indices)},
+      m_uvs {std::move(uvs)}
+{
+    m_indices.resize(m_indices.size() - m_indices.size() % 3);
+    if (!m_uvs.empty() && m_uvs.size() != m_positions.size()) {
+        logger.logWarn("apbr::TriangleMesh: one uv per position expected, ignoring the uvs.");
+        m_uvs.clear();
+    }
+    m_bvh.build(triangleBounds(*this));
+}
+
+bool TriangleMesh::intersect(Ray &ray, Hit &hit) const
+{
+    bool found = false;
+    m_bvh.intersect(ray, [&](std::uint32_t primitive, Ray &r) {
+        float t, b1, b2;
+        if (!apbr::intersect(r, triangle(primitive), t, b1, b2))
+            return false;
+
+        r.tMax        = t;
+        hit.t         = t;
+        hit.b1        = b1;
+        hit.b2        = b2;
+        hit.primitive = primitive;
+        found         = true;
+        return true;
+    });
+    return found;
+}
+
+bool TriangleMesh::occluded(const Ray &ray) const
+{
+    return m_bvh.occluded(ray, [&](std::uint32_t primitive, const Ray &r) {
+        float t, b1, b2;
+        return apbr::intersect(r, triangle(primitive), t, b1, b2);
+    });
+}
+
+void TriangleMesh::intersect(RayPacket &packet, PacketHit &hit) const
+{
+    for (int lane = 0; lane < RayPacket::size; ++lane)
+        hit.primitive[lane] = BVH::invalid;
+
+    m_bvh.intersect(
+        packet,
+        [&](std::uint32_t primitive, RayPacket &p, std::uint32_t lanes) {
+            simd::vfloat t, b1, b2;
+            const auto   hits =
+                intersectPacket(triangle(primitive), p, lanes, t, b1, b2);
+            if (hits == 0)
+                return hits;
+
+            alignas(32) float ts[RayPacket::size], b1s[RayPacket::size],
+                b2s[RayPacket::size];
+            simd::store(ts, t);
+            simd::store(b1s, b1);
+            simd::store(b2s, b2);
+            for (auto b = hits; b != 0; b &= b - 1) {
+                const int lane      = std::countr_zero(b);
+                p.tMax[lane]        = ts[lane];
+                hit.b1[lane]        = b1s[lane];
+                hit.b2[lane]        = b2s[lane];
+                hit.primitive[lane] = primitive;
+            }
+            return hits;
+        });
+}
+
+std::uint32_t TriangleMesh::occluded(const RayPacket &packet) const
+{
+    return m_bvh.occluded(
+        packet,
+        [&](std::uint32_t primitive, RayPacket &p, std::uint32_t lanes) {
+            simd::vfloat t, b1, b2;
+            return intersectPacket(triangle(primitive), p, lanes, t, b1, b2);
+        });
+}
+
+}    // namespace apbr
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <apbr/BVH.hpp>
+#include <apbr/geometry.hpp>
+#include <apbr/Scene.hpp>
+#include <apbr/Texture.hpp>
+#include <apbr/TriangleMesh.hpp>
+
+namespace apbr {
+
+struct Instance
+{
+    // bottom level, built once and shared by every instance of the mesh.
+    std::shared_ptr<const TriangleMesh> mesh;
+    glm::mat4                           objectToWorld {1.0f};
+    // optional, looked up with the mesh's texture coordinates.
+    std::shared_ptr<const Texture>      albedo;
+};
+
+// Two level acceleration structure: every mesh keeps its own BVH (bottom level) and a BVH over
+// the world bounds of the instances (top level) places them in the scene. Moving an instance
+// only touches the top level, which is refitted in O(instances) and rebuilt only once the
+// refits have degraded it too much.
+//
+// Copying is cheap (the meshes are shared), so a renderer can trace one copy while the next
+// frame's transforms are applied to another.
+class Accel
+{
+public:
+    // rebuild the top level once refitting made it this much more expensive than a fresh build.
+    static constexpr float rebuildThreshold = 1.5f;
+
+    Accel() = default;
+
+    explicit Accel(std::vector<Instance> instances);
+
+    std::span<const Instance> instances() const { return m_instances; }
+
+    const glm::mat4          &worldToObject(std::size_t instance) const
+    {
+        return m_worldToObject[instance];
+    }
+
+    /// @brief Move all instances, then refit (or if needed rebuild) the top level.
+    /// @param objectToWorld one transform per instance, in the order of `instances()`.
+    void          setTransforms(std::span<const glm::mat4> objectToWorld);
+
+    /// @brief Same, with the world transforms of `scene` (after its `update`).
+    /// @param nodes one node per instance, in the order of `instances()`.
+    void          setTransforms(const Scene &scene, std::span<const Scene::Node> nodes);
+
+    Bounds3f      bounds() const { return m_bvh.bounds(); }
+
+    // number of top level rebuilds caused by `setTransforms`.
+    std::size_t   rebuildCount() const { return m_rebuilds; }
+
+    // closest hit in world space; fills `hit.instance` and the triangle of that instance's mesh.
+    bool          intersect(Ray &ray, Hit &hit) const;
+
+    bool          occluded(const Ray &ray) const;
+
+    // closest hits of the active lanes of `packet`, e.g. the primary rays of neighbouring
+    // pixels. Lanes that hit nothing get `BVH::invalid` as primitive.
+    void          intersect(RayPacket &packet, PacketHit &hit) const;
+
+    // shadow rays. Returns the bits of the occluded lanes.
+    std::uint32_t occluded(const RayPacket &packet) const;
+
+    // world space geometric normal at `hit`, not yet facing any particular side.
+    glm::vec3     normal(const Hit &hit) const;
+
+    /// @brief Texture coordinates at `hit` and how fast they change from pixel to pixel, found
+    /// by intersecting the differential rays with the tangent plane (PBR book, section 10.1).
+    /// Without differentials the footprint is a point.
+    TextureFootprint textureFootprint(const Hit &hit, const RayDifferential &ray) const;
+
+private:
+    void       updateInstance(std::size_t i);
+
+    // after moving instances.
+    void       refitTopLevel();
+
+    static Ray toObject(const glm::mat4 &worldToObject, const Ray &ray)
+    {
+        // the direction is left unnormalized so distances match the world space ray.
+        return Ray {glm::vec3 {worldToObject * glm::vec4 {ray.origin, 1.0f}},
+                    glm::vec3 {worldToObject * glm::vec4 {ray.direction, 0.0f}},
+                    ray.tMax};
+    }
+
+    static RayPacket toObject(const glm::mat4 &worldToObject, const RayPacket &packet);
+
+private:
+    std::vector<Instance>  m_instances;
+    std::vector<glm::mat4> m_worldToObject;
+    std::vector<Bounds3f>  m_worldBounds;
+    BVH                    m_bvh;
+    // `m_bvh.sahCost()` right after the last build.
+    float                  m_builtCost = 0.0f;
+    std::size_t            m_rebuilds  = 0;
+};
+
+}    // namespace apbr
@@ -0,0 +1,396 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include <apbr/geometry.hpp>
+#include <apbr/simd.hpp>
+
+namespace apbr {
+
+// `simd::width` rays traced together, stored structure-of-arrays.
+// Coherent rays (primary rays of a tile, shadow rays towards one light) share most of their traversal.
+struct alignas(32) RayPacket
+{
+    static constexpr int size = simd::width;
+
+    void                 set(int lane, const Ray &ray)
+    {
+        ox[lane]   = ray.origin.x;
+        oy[lane]   = ray.origin.y;
+        oz[lane]   = ray.origin.z;
+        dx[lane]   = ray.direction.x;
+        dy[lane]   = ray.direction.y;
+        dz[lane]   = ray.direction.z;
+        tMax[lane] = ray.tMax;
+    }
+
+    Ray ray(int lane) const
+    {
+        return Ray {
+            {ox[lane], oy[lane], oz[lane]},
+            {dx[lane], dy[lane], dz[lane]},
+            tMax[lane]
+        };
+    }
+
+    float         ox[size];
+    float         oy[size];
+    float         oz[size];
+    float         dx[size];
+    float         dy[size];
+    float         dz[size];
+    float         tMax[size];
+    // lanes taking part in the trace; unused lanes are never touched.
+    std::uint32_t active = simd::all_lanes;
+};
+
+struct BVHBuildOptions
+{
+    int   maxLeafSize   = 4;
+    int   binCount      = 16;
+    // cost of a node visit relative to one primitive intersection.
+    float traversalCost = 1.0f;
+};
+
+// Bounding volume hierarchy with `simd::width` children per node (BVH4 on SSE, BVH8 on AVX2).
+// It is built as a binary SAH tree and then collapsed, so every node test checks one ray
+// against all children at once. The BVH only knows primitive bounds; what a primitive is
+// gets decided by the leaf callback passed to the traversal functions.
+class BVH
+{
+public:
+    static constexpr int           width   = simd::width;
+    static constexpr std::uint32_t invalid = ~0u;
+
+    // children bounds are stored structure-of-arrays, one lane per child.
+    struct alignas(32) Node
+    {
+        float         lower[3][width];
+        float         upper[3][width];
+        // index of the child node for inner children, first slot in `primitiveIndices()` for leaves.
+        std::uint32_t child[width];
+        // 0 for inner children and unused slots, number of primitives for leaves.
+        std::uint32_t count[width];
+
+        bool          used(int slot) const { return child[slot] != invalid; }
+
+        bool isLeaf(int slot) const { return count[slot] != 0; }
+
+        Bounds3f      bounds(int slot) const
+        {
+            return Bounds3f {
+                {lower[0][slot], lower[1][slot], lower[2][slot]},
+                {upper[0][slot], upper[1][slot], upper[2][slot]}
+            };
+        }
+
+        void setBounds(int slot, const Bounds3f &b)
+        {
+            for (int axis = 0; axis < 3; ++axis) {
+                lower[axis][slot] = b.lower[axis];
+                upper[axis][slot] = b.upper[axis];
+            }
+        }
+    };
+
+    using BuildOptions = BVHBuildOptions;
+
+    BVH() = default;
+
+    explicit BVH(std::span<const Bounds3f> primitives,
+                 const BuildOptions       &options = {})
+    {
+        build(primitives, options);
+    }
+
+    /// @param scratch where the builder keeps its temporary arrays, e.g. a `FrameArena` that is
+    /// reset after the build, so rebuilding doesn't go to the heap.
+    void build(std::span<const Bounds3f>  primitives,
+               const BuildOptions        &options = {},
+               std::pmr::memory_resource *scratch = std::pmr::get_default_resource());
+
+    /// @brief Recompute all node bounds bottom up for primitives that moved, in O(n).
+    /// The topology is kept, so the tree gets slower to trace the further the primitives
+    /// move from where they were at `build` time; compare `sahCost` to decide when to rebuild.
+    /// @param primitives same count and order as passed to `build`.
+    void  refit(std::span<const Bounds3f> primitives);
+
+    // expected cost of tracing a ray, in units of primitive intersections (surface area heuristic).
+    float sahCost(const BuildOptions &options = {}) const;
+
+    bool  empty() const { return m_nodes.empty(); }
+
+    Bounds3f                       bounds() const;
+
+    std::span<const Node>          nodes() const { return m_nodes; }
+
+    std::span<const std::uint32_t> primitiveIndices() const
+    {
+        return m_primIndices;
+    }
+
+    /// @brief Closest hit traversal.
+    /// @param leaf `bool(std::uint32_t primitive, Ray &ray)`. Must shrink `ray.tMax` and return true on a hit.
+    template<typename LeafFn>
+    void intersect(Ray &ray, LeafFn &&leaf) const;
+
+    /// @brief Any hit traversal, stops at the first primitive `leaf` reports as hit.
+    /// @param leaf `bool(std::uint32_t primitive, const Ray &ray)`
+    template<typename LeafFn>
+    bool occluded(const Ray &ray, LeafFn &&leaf) const;
+
+    /// @brief Closest hit traversal for all active lanes of `packet`.
+    /// @param leaf `std::uint32_t(std::uint32_t primitive, RayPacket &packet, std::uint32_t lanes)`.
+    /// Must shrink `packet.tMax` of the lanes it hits and return their bits.
+    template<typename LeafFn>
+    void intersect(RayPacket &packet, LeafFn &&leaf) const;
+
+    /// @brief Any hit traversal for all active lanes of `packet`.
+    /// @param leaf same as for the closest hit packet traversal, but does not need to update `tMax`.
+    /// @return bits of the lanes that are occluded.
+    template<typename LeafFn>
+    std::uint32_t occluded(const RayPacket &packet, LeafFn &&leaf) const;
+
+private:
+    struct StackEntry
+    {
+        std::uint32_t child;
+        std::uint32_t count;
+        float         t;
+    };
+
+    // worst case is `(depth * (width - 1)) + 1`; the builder caps the depth to keep this bound.
+    static constexpr int stackSize = 64 * (width - 1) + 1;
+    using Stack                    = std::array<StackEntry, stackSize>;
+
+    // zero direction components would turn the slab distances into `inf - inf`.
+    static float safeInverse(float d)
+    {
+        constexpr float tiny = 1e-18f;
+        return 1.0f / (std::abs(d) > tiny ? d : std::copysign(tiny, d));
+    }
+
+    template<bool anyHit, typename LeafFn>
+    bool traverse(Ray &ray, LeafFn &&leaf) const;
+
+    template<bool anyHit, typename LeafFn>
+    std::uint32_t traverse(RayPacket &packet, LeafFn &&leaf) const;
+
+    // push the children in `hits` sorted by `t`, nearest on top of the stack.
+    static void   pushSorted(const Node          &node,
+                             std::uint32_t        hits,
+                             const float         *t,
+                             Stack               &stack,
+                             int                 &top);
+
+private:
+    std::vector<Node>          m_nodes;
+    std::vector<std::uint32_t> m_primIndices;
+};
+
+inline void BVH::pushSorted(const Node   &node,
+                            std::uint32_t hits,
+                            const float  *t,
+                            Stack        &stack,
+                            int          &top)
+{
+    StackEntry sorted[width];
+    int        n = 0;
+    for (; hits != 0; hits &= hits - 1) {
+        const int slot = std::countr_zero(hits);
+        auto      e    = StackEntry {node.child[slot], node.count[slot], t[slot]};
+        // insertion sort, farthest first. Nodes rarely have more than a few hit children.
+        int       i    = n++;
+        for (; i > 0 && sorted[i - 1].t < e.t; --i)
+            sorted[i] = sorted[i - 1];
+        sorted[i] = e;
+    }
+    for (int i = 0; i < n; ++i)
+        stack[top++] = sorted[i];
+}
+
+template<bool anyHit, typename LeafFn>
+bool BVH::traverse(Ray &ray, LeafFn &&leaf) const
+{
+    if (m_nodes.empty())
+        return false;
+
+    const auto invDir = glm::vec3 {safeInverse(ray.direction.x),
+                                   safeInverse(ray.direction.y),
+                                   safeInverse(ray.direction.z)};
+    // slab distances are `plane * invDir - origin * invDir`, which maps to a single fmadd.
+    simd::vfloat     idir[3], oidir[3];
+    int              nearPlane[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        idir[axis]      = simd::broadcast(invDir[axis]);
+        oidir[axis]     = simd::broadcast(-ray.origin[axis] * invDir[axis]);
+        nearPlane[axis] = invDir[axis] < 0.0f;
+    }
+    // pbrt's conservative factor `1 + 2 * gamma(3)` so boxes are never missed due to rounding.
+    constexpr float robust = 1.0f + 2.0f * 3.0f * 0x1p-24f;
+
+    Stack           stack;
+    int             top = 0;
+    stack[top++]        = StackEntry {0, 0, 0.0f};
+
+    bool hit            = false;
+    while (top > 0) {
+        const auto entry = stack[--top];
+        if (entry.t > ray.tMax)
+            continue;
+
+        if (entry.count != 0) {
+            for (auto i = entry.child; i < entry.child + entry.count; ++i) {
+                if (leaf(m_primIndices[i], ray)) {
+                    hit = true;
+                    if constexpr (anyHit)
+                        return true;
+                }
+            }
+            continue;
+        }
+
+        const auto &node  = m_nodes[entry.child];
+        auto        tNear = simd::broadcast(0.0f);
+        auto        tFar  = simd::broadcast(ray.tMax);
+        for (int axis = 0; axis < 3; ++axis) {
+            const float *nearSide = nearPlane[axis] ? node.upper[axis]
+                                                    : node.lower[axis];
+            const float *farSide  = nearPlane[axis] ? node.lower[axis]
+                                                    : node.upper[axis];
+            tNear = simd::max(
+                tNear,
+                simd::fmadd(simd::load(nearSide), idir[axis], oidir[axis]));
+            tFar = simd::min(
+                tFar,
+                simd::fmadd(simd::load(farSide), idir[axis], oidir[axis]));
+        }
+        const auto hits = simd::bits(tNear <= tFar * simd::broadcast(robust));
+        if (hits == 0)
+            continue;
+
+        alignas(32) float t[width];
+        simd::store(t, tNear);
+        pushSorted(node, hits, t, stack, top);
+    }
+    return hit;
+}
+
+template<bool anyHit, typename LeafFn>
+std::uint32_t BVH::traverse(RayPacket &packet, LeafFn &&leaf) const
+{
+    if (m_nodes.empty())
+        return 0;
+
+    simd::vfloat org[3], idir[3];
+    const float *o[3] = {packet.ox, packet.oy, packet.oz};
+    const float *d[3] = {packet.dx, packet.dy, packet.dz};
+    for (int axis = 0; axis < 3; ++axis) {
+        alignas(32) float inv[width];
+        for (int lane = 0; lane < width; ++lane)
+            inv[lane] = safeInverse(d[axis][lane]);
+        org[axis]  = simd::load(o[axis]);
+        idir[axis] = simd::load(inv);
+    }
+    constexpr float robust = 1.0f + 2.0f * 3.0f * 0x1p-24f;
+
+    // `active` shrinks as lanes of an occlusion query find their blocker.
+    auto            active = packet.active & simd::all_lanes;
+    std::uint32_t   result = 0;
+
+    Stack           stack;
+    int             top    = 0;
+    stack[top++]           = StackEntry {0, 0, 0.0f};
+
+    while (top > 0 && active != 0) {
+        const auto entry = stack[--top];
+
+        if (entry.count != 0) {
+            for (auto i = entry.child; i < entry.child + entry.count; ++i) {
+                const auto hits = leaf(m_primIndices[i], packet, active);
+                result |= hits;
+                if constexpr (anyHit) {
+                    active &= ~hits;
+                    if (active == 0)
+                        break;
+                }
+            }
+            continue;
+        }
+
+        // one child against all rays of the packet per step.
+        const auto &node   = m_nodes[entry.child];
+        const auto  tMax   = simd::load(packet.tMax) * simd::broadcast(robust);
+        const auto  lanes  = simd::from_bits(active);
+        std::uint32_t hits = 0;
+        alignas(32) float t[width];
+        for (int slot = 0; slot < width; ++slot) {
+            if (!node.used(slot))
+                continue;
+
+            auto tNear = simd::broadcast(0.0f);
+            auto tFar  = tMax;
+            for (int axis = 0; axis < 3; ++axis) {
+                const auto t0 =
+                    (simd::broadcast(node.lower[axis][slot]) - org[axis])
+                    * idir[axis];
+                const auto t1 =
+                    (simd::broadcast(node.upper[axis][slot]) - org[axis])
+                    * idir[axis];
+                tNear = simd::max(tNear, simd::min(t0, t1));
+                tFar  = simd::min(tFar, simd::max(t0, t1));
+            }
+            const auto laneHits = simd::bits((tNear <= tFar) & lanes);
+            if (laneHits == 0)
+                continue;
+
+            // order children by the nearest entry of any lane that hits them.
+            alignas(32) float near[width];
+            simd::store(near, tNear);
+            t[slot] = infinity;
+            for (auto b = laneHits; b != 0; b &= b - 1)
+                t[slot] = std::min(t[slot], near[std::countr_zero(b)]);
+            hits |= 1u << slot;
+        }
+        if (hits != 0)
+            pushSorted(node, hits, t, stack, top);
+    }
+    return result;
+}
+
+template<typename LeafFn>
+void BVH::intersect(Ray &ray, LeafFn &&leaf) const
+{
+    traverse<false>(ray, leaf);
+}
+
+template<typename LeafFn>
+bool BVH::occluded(const Ray &ray, LeafFn &&leaf) const
+{
+    auto r = ray;
+    return traverse<true>(r, [&](std::uint32_t primitive, Ray &r) {
+        return leaf(primitive, static_cast<const Ray &>(r));
+    });
+}
+
+template<typename LeafFn>
+void BVH::intersect(RayPacket &packet, LeafFn &&leaf) const
+{
+    traverse<false>(packet, leaf);
+}
+
+template<typename LeafFn>
+std::uint32_t BVH::occluded(const RayPacket &packet, LeafFn &&leaf) const
+{
+    auto p = packet;
+    return traverse<true>(p, leaf);
+}
+
+}    // namespace apbr
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <apbr/geometry.hpp>
+
+namespace apbr {
+
+// Pinhole camera of the CPU integrators (`generateRay`).
+class Camera
+{
+public:
+    Camera() = default;
+
+    Camera(const glm::vec3 &position,
+           const glm::vec3 &target,
+           const glm::vec3 &up,
+           float            fovY,
+           float            aspect)
+        : m_position {position},
+          m_target {target},
+          m_up {up},
+          m_fovY {fovY},
+          m_aspect {aspect}
+    {
+    }
+
+    bool             operator==(const Camera &) const = default;
+
+    const glm::vec3 &position() const { return m_position; }
+
+    const glm::vec3 &target() const { return m_target; }
+
+    // vertical field of view in radians
+    float            fovY() const { return m_fovY; }
+
+    float            aspect() const { return m_aspect; }
+
+    void             setAspect(float aspect) { m_aspect = aspect; }
+
+    // move position and target together.
+    void             translate(const glm::vec3 &offset)
+    {
+        m_position += offset;
+        m_target   += offset;
+    }
+
+    /// @brief Primary ray through a point on the image plane.
+    /// @param ndc normalized device coordinates, `[-1, 1]` on both axes with `+y` up.
+    Ray             generateRay(const glm::vec2 &ndc) const;
+
+    /// @brief `generateRay` plus the rays one pixel over in x and y.
+    /// @param pixelSize size of a pixel in normalized device coordinates, `2 / resolution`.
+    RayDifferential generateRayDifferential(const glm::vec2 &ndc,
+                                            const glm::vec2 &pixelSize) const;
+
+private:
+    glm::vec3 m_position {0.0f, 0.0f, 2.0f};
+    glm::vec3 m_target {0.0f};
+    glm::vec3 m_up {0.0f, 1.0f, 0.0f};
+    float     m_fovY   = 0.785398f;
+    float     m_aspect = 1.0f;
+};
+
+}    // namespace apbr
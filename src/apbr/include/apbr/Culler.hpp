@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <apbr/BVH.hpp>
+#include <apbr/geometry.hpp>
+#include <apbr/memory.hpp>
+#include <apbr/TaskScheduler.hpp>
+
+namespace apbr {
+
+// The six clip planes of a view projection, as `(normal, d)` with the normals pointing inwards:
+// a point is inside a plane when `dot(normal, p) + d >= 0`. The planes are not normalized,
+// which is fine for inside/outside tests.
+struct Frustum
+{
+    enum Plane { Left, Right, Bottom, Top, Near, Far, planeCount };
+
+    Frustum() = default;
+
+    // Gribb and Hartmann, for OpenGL's [-1, 1] clip space depth.
+    explicit Frustum(const glm::mat4 &viewProjection);
+
+    // false only if `b` is entirely outside one of the planes; boxes near the corners of the
+    // frustum may pass although they are outside.
+    bool intersects(const Bounds3f &b) const;
+
+    std::array<glm::vec4, planeCount> planes {};
+};
+
+// Max depth pyramid of a depth buffer, for hierarchical Z occlusion tests: every level halves
+// the resolution of the one before and keeps the farthest depth of the texels it covers, so a
+// box whose nearest point is behind that depth is behind everything drawn there.
+//
+// Built from the previous frame's depth, which is all there is before drawing. Boxes are
+// tested with the current matrices, so something uncovered by the camera moving can be culled
+// for the frame it appears in.
+class HiZBuffer
+{
+public:
+    HiZBuffer() = default;
+
+    /// @brief Rebuild the pyramid. Memory is kept from the last build of the same size.
+    /// @param depth window depth in [0, 1], bottom row first, as `glReadPixels` returns it.
+    void  build(int                     width,
+                int                     height,
+                std::span<const float>  depth,
+                TaskScheduler          &scheduler = TaskScheduler::global());
+
+    bool  empty() const { return m_levels.empty(); }
+
+    int   levelCount() const { return static_cast<int>(m_levels.size()); }
+
+    /// @brief True if `b` is certainly hidden behind the depth buffer. Boxes crossing the near
+    /// plane are never occluded.
+    /// @param viewProjection the matrix the depth buffer was drawn with.
+    bool  occluded(const Bounds3f &b, const glm::mat4 &viewProjection) const;
+
+private:
+    struct Level
+    {
+        int                width  = 0;
+        int                height = 0;
+        std::vector<float> depth;
+
+        float              at(int x, int y) const
+        {
+            return depth[static_cast<std::size_t>(y) * width + x];
+        }
+    };
+
+    std::vector<Level> m_levels;
+};
+
+// Finds the instances a camera can see, so only those get recorded for drawing.
+//
+// The world bounds of the instances go into a `BVH` with one instance per leaf, and a frame's
+// cull walks it top down: every node tests the bounds of all its `simd::width` children
+// against the frustum planes at once, and drops the subtrees outside. Children entirely inside
+// a plane don't test it again below, so subtrees inside the frustum are collected without
+// any plane tests. With a `HiZBuffer` the children that pass are also tested for occlusion,
+// again whole subtrees at a time.
+//
+// Like `Accel`'s top level, moving instances refits the hierarchy, which is rebuilt once
+// refitting has degraded it too much.
+class Culler
+{
+public:
+    struct Stats
+    {
+        // inner nodes tested, each one with up to `simd::width` boxes.
+        std::size_t nodes    = 0;
+        // subtrees and instances dropped by the depth pyramid.
+        std::size_t occluded = 0;
+        std::size_t visible  = 0;
+    };
+
+    // rebuild once refitting made the hierarchy this much more expensive than a fresh build.
+    static constexpr float rebuildThreshold = 1.5f;
+
+    Culler() = default;
+
+    /// @brief Set the world bounds of all instances. Refits the hierarchy if the count is the
+    /// same as last time, else rebuilds it.
+    void                           setBounds(std::span<const Bounds3f> instances);
+
+    /// @brief Indices into the bounds passed to `setBounds` of every instance inside the
+    /// frustum of `viewProjection` and, if `occluders` is given, not hidden by it. Empty
+    /// instances are never visible.
+    /// @return valid until the next call; the order is unspecified.
+    std::span<const std::uint32_t> cull(const glm::mat4 &viewProjection,
+                                        const HiZBuffer *occluders = nullptr);
+
+    const Stats                   &stats() const { return m_stats; }
+
+private:
+    struct StackEntry
+    {
+        std::uint32_t node;
+        // planes the subtree is not yet known to be inside of.
+        std::uint32_t planes;
+    };
+
+    std::vector<Bounds3f>      m_bounds;
+    BVH                        m_bvh;
+    float                      m_builtCost = 0.0f;
+    // the builder's temporaries, reset after every rebuild.
+    FrameArena                 m_buildScratch {std::size_t {16} << 10};
+
+    // kept between frames.
+    std::vector<StackEntry>    m_stack;
+    std::vector<std::uint32_t> m_visible;
+    Stats                      m_stats;
+};
+
+}    // namespace apbr
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <apbr/Tile.hpp>
+
+namespace apbr {
+
+struct DenoiserOptions
+{
+    int   iterations  = 5;
+    // how different two pixels' irradiance (color over albedo) may be and still get blended,
+    // in the first iteration. Halved every iteration after it, as the noise left shrinks.
+    float colorSigma  = 1.0f;
+    // same for the (mean) normals, per unit of tap distance...
+    float normalSigma = 0.5f;
+    // ...and the depth, relative to the depth of the pixel being filtered.
+    float depthSigma  = 0.1f;
+};
+
+// Images for `Denoiser::denoise`, `width * height` pixels each, interleaved (RGB, XYZ) except
+// for the depth. Row order doesn't matter as long as it's the same for all of them, e.g. a
+// `ProgressiveRenderer::Image`.
+struct DenoiserInput
+{
+    int                     width  = 0;
+    int                     height = 0;
+    std::span<const float>  color;
+    std::span<const float>  albedo;
+    std::span<const float>  normal;
+    std::span<const float>  depth;
+};
+
+// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010) guided by the first hit features
+// of the integrator. Color is divided by albedo first, so texture detail is kept and only the
+// lighting is smoothed. Every iteration applies a 5 x 5 B3 spline kernel with its taps spread
+// twice as far as in the previous one.
+//
+// The image is kept in planes; the kernel filters `simd::width` pixels of a row at once and
+// tiles of the image are spread over `TaskScheduler::global()`.
+class Denoiser
+{
+public:
+    using Options = DenoiserOptions;
+
+    explicit Denoiser(const Options &options = {});
+
+    const Options &options() const { return m_options; }
+
+    void           setOptions(const Options &options) { m_options = options; }
+
+    /// @brief Filter `input.color` into `rgb` (same layout). `rgb` may alias `input.color`.
+    /// Buffers are kept between calls, so reuse one `Denoiser` for a stream of images.
+    void           denoise(const DenoiserInput &input, std::span<float> rgb);
+
+private:
+    struct Plane3
+    {
+        std::vector<float> x, y, z;
+    };
+
+    void resize(int width, int height);
+
+    // one iteration over the pixels of `tile`, from `m_color[src]` into the other buffer.
+    void filterTile(const Tile &tile, int step, float colorSigma, int src);
+
+private:
+    Options            m_options;
+    int                m_width  = 0;
+    int                m_height = 0;
+    std::vector<Tile>  m_tiles;
+
+    // demodulated color, ping-ponged between iterations.
+    Plane3             m_color[2];
+    Plane3             m_albedo;
+    Plane3             m_normal;
+    std::vector<float> m_depth;
+};
+
+}    // namespace apbr
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <apbr/Tile.hpp>
+
+namespace apbr {
+
+// What the first hit of a camera ray looked like, besides its radiance. Averaged per pixel by
+// the film, these guide the denoiser.
+struct PixelFeatures
+{
+    // depth of rays that hit nothing, far enough to never look like a neighbouring surface.
+    static constexpr float missDepth = 1e6f;
+
+    glm::vec3              albedo {1.0f};
+    glm::vec3              normal {0.0f};
+    float                  depth = missDepth;
+};
+
+// HDR accumulation buffer. Every pixel keeps the running mean and variance of its samples
+// (Welford's algorithm), so a progressive renderer can keep adding passes until the image is
+// reset, and tell how far from converged each part of the image still is.
+// Pixel rows go from top (y = 0) to bottom.
+// Threads may add samples concurrently as long as they work on disjoint tiles.
+class Film
+{
+public:
+    Film(int width, int height);
+
+    int       width() const { return m_width; }
+
+    int       height() const { return m_height; }
+
+    void      reset();
+
+    void      addSample(int                  x,
+                        int                  y,
+                        const glm::vec3     &radiance,
+                        const PixelFeatures &features = {})
+    {
+        auto &p          = m_pixels[y * m_width + x];
+        p.count          += 1.0f;
+        const auto delta = radiance - p.mean;
+        p.mean           += delta / p.count;
+        p.m2             += delta * (radiance - p.mean);
+        p.albedoSum      += features.albedo;
+        p.normalSum      += features.normal;
+        p.depthSum       += features.depth;
+    }
+
+    int       sampleCount(int x, int y) const
+    {
+        return static_cast<int>(m_pixels[y * m_width + x].count);
+    }
+
+    // mean radiance of a pixel, black if it has no samples.
+    glm::vec3 average(int x, int y) const { return m_pixels[y * m_width + x].mean; }
+
+    // unbiased sample variance of a pixel's radiance, per channel.
+    glm::vec3 variance(int x, int y) const
+    {
+        const auto &p = m_pixels[y * m_width + x];
+        return p.count > 1.0f ? p.m2 / (p.count - 1.0f) : glm::vec3 {0.0f};
+    }
+
+    /// @brief Estimated error of the pixels of `tile`: the root mean square over its pixels of
+    /// the standard error of their mean, relative to their brightness. Pixels darker than `minBrightness`
+    /// count as that bright, so black regions don't need an endless number of samples.
+    /// @return infinity while some pixel has fewer than two samples.
+    float     error(const Tile &tile, float minBrightness = 0.05f) const;
+
+    /// @brief Write the mean radiance of `tile` into an RGB float image of the film's size.
+    /// Rows are flipped (bottom row first) to match OpenGL's texture origin.
+    void resolve(const Tile &tile, std::span<float> rgb) const;
+
+    /// @brief Like `resolve`, for the mean features: RGB albedo, XYZ normal and one depth per
+    /// pixel.
+    void resolveFeatures(const Tile       &tile,
+                         std::span<float> albedo,
+                         std::span<float> normal,
+                         std::span<float> depth) const;
+
+private:
+    struct Pixel
+    {
+        glm::vec3 mean {0.0f};
+        // sum of squared differences from the mean
+        glm::vec3 m2 {0.0f};
+        glm::vec3 albedoSum {0.0f};
+        glm::vec3 normalSum {0.0f};
+        float     depthSum = 0.0f;
+        float     count    = 0.0f;
+    };
+
+    int                m_width;
+    int                m_height;
+    std::vector<Pixel> m_pixels;
+};
+
+}    // namespace apbr
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <apbr/MappedFile.hpp>
+#include <apbr/TaskScheduler.hpp>
+
+namespace apbr {
+
+struct IBLOptions
+{
+    // width of the irradiance map; all equirectangular maps are half as high as wide.
+    int irradianceSize  = 32;
+    // width of the first prefiltered level, which should be a power of two.
+    int specularSize    = 256;
+    // roughness goes from 0 at the first level to 1 at the last.
+    int specularLevels  = 6;
+    int specularSamples = 256;
+    int brdfSize        = 128;
+    int brdfSamples     = 512;
+};
+
+// Precomputed image based lighting for the split sum approximation (Karis, "Real Shading in
+// Unreal Engine 4", 2013):
+// - `irradiance`: the cosine weighted average of the environment around every normal, i.e.
+//   irradiance over pi, so diffuse light is the albedo times a lookup. From the environment's
+//   spherical harmonics up to order 2 (Ramamoorthi and Hanrahan 2001).
+// - `specular(level)`: the environment convolved with GGX lobes of growing roughness (alpha is
+//   roughness squared), one MIP level each; sizes halve like a GL MIP chain. Importance
+//   sampled with filtered lookups into a MIP chain of the environment (Krivanek and Colbert
+//   2008), so few samples give smooth levels.
+// - `brdf`: the scale and bias applied to F0 by the split sum, indexed by n.v (x) and
+//   roughness (y). Rows go from roughness 0 to 1 like the specular levels, so look rows up at
+//   `roughness * (height - 1)`; columns are texel centers of n.v.
+//
+// Environment maps are equirectangular RGB with +y up in the first row, the way stb_image
+// loads a .hdr file: `x / width` turns around +y starting at +x, towards +z.
+//
+// Building takes a while, so the result can be written to a cache file. Opening the cache maps
+// it into memory, and the images point into the mapping; nothing is decoded or copied. The
+// cache is keyed by `hashSource`, so a changed environment or options miss it.
+class IBL
+{
+public:
+    using Options = IBLOptions;
+
+    struct Image
+    {
+        int                    width    = 0;
+        int                    height   = 0;
+        int                    channels = 0;
+        // rows of `width * channels` floats.
+        std::span<const float> texels;
+    };
+
+    /// @brief Build all maps from an environment.
+    /// @param rgb `width * height` texels, 3 floats each.
+    IBL(int                     width,
+        int                     height,
+        std::span<const float>  rgb,
+        const Options          &options   = {},
+        TaskScheduler          &scheduler = TaskScheduler::global());
+
+    IBL(const IBL &)            = delete;
+    IBL &operator=(const IBL &) = delete;
+
+    IBL(IBL &&)                 = default;
+    IBL &operator=(IBL &&)      = default;
+
+    /// @brief Key of the cache file for an environment, from the bytes of its source (say the
+    /// .hdr file, so a cache hit doesn't even need to decode it) and the options.
+    static std::uint64_t      hashSource(std::span<const std::byte> source,
+                                         const Options             &options = {});
+
+    /// @brief Map a file written by `writeCache`.
+    /// @return nothing if there is no such file or it was written for another key.
+    static std::optional<IBL> fromCache(const std::filesystem::path &path,
+                                        std::uint64_t                key);
+
+    bool         writeCache(const std::filesystem::path &path, std::uint64_t key) const;
+
+    // whether the images point into a cache file.
+    bool         mapped() const { return m_file.has_value(); }
+
+    const Image &irradiance() const { return m_images[0]; }
+
+    const Image &brdf() const { return m_images[1]; }
+
+    int          specularLevels() const { return static_cast<int>(m_images.size()) - 2; }
+
+    const Image &specular(int level) const { return m_images[2 + level]; }
+
+private:
+    IBL() = default;
+
+    // lay out `images` (sizes only) back to back in `m_storage` and point them into it.
+    void allocate(std::vector<Image> images);
+
+private:
+    // irradiance, brdf, then the specular levels.
+    std::vector<Image>        m_images;
+    // what the images point into: one of the two.
+    std::vector<float>        m_storage;
+    std::optional<MappedFile> m_file;
+};
+
+}    // namespace apbr
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <span>
+
+#include <glm/glm.hpp>
+
+#include <apbr/Accel.hpp>
+#include <apbr/Film.hpp>
+#include <apbr/geometry.hpp>
+#include <apbr/Sampler.hpp>
+
+namespace apbr {
+
+// a camera ray and the pixel sample it was generated for.
+struct CameraSample
+{
+    glm::ivec2      pixel {0};
+    int             index = 0;
+    RayDifferential ray;
+};
+
+// Estimates the radiance arriving along camera rays. `Li` is called concurrently from many
+// threads, so implementations must not mutate shared state. It also describes the first hit in
+// `features`, for the denoiser.
+class Integrator
+{
+public:
+    virtual ~Integrator() = default;
+
+    virtual glm::vec3 Li(RayDifferential ray,
+                         Sampler        &sampler,
+                         PixelFeatures  &features) const = 0;
+
+    /// @brief `Li` of up to `RayPacket::size` samples at once, so they can be traced as packets.
+    /// The dimensions of sample `i` come from `sampler` restarted at `samples[i]`, past its
+    /// pixel offset. The default calls `Li` for one sample after the other.
+    virtual void      LiPacket(std::span<const CameraSample> samples,
+                               Sampler                      &sampler,
+                               std::span<glm::vec3>          L,
+                               std::span<PixelFeatures>      features) const;
+};
+
+// Diffuse surfaces under a uniform sky: one cosine weighted visibility ray per sample. Instances
+// with an albedo texture scale `albedo` by it.
+// Converges in a handful of passes, which makes it a good fit for the interactive preview.
+class AOIntegrator : public Integrator
+{
+public:
+    AOIntegrator(std::shared_ptr<const Accel> scene,
+                 const glm::vec3             &albedo      = glm::vec3 {0.8f},
+                 const glm::vec3             &sky         = glm::vec3 {1.0f},
+                 float                        maxDistance = infinity)
+        : m_scene {std::move(scene)},
+          m_albedo {albedo},
+          m_sky {sky},
+          m_maxDistance {maxDistance}
+    {
+    }
+
+    glm::vec3 Li(RayDifferential ray,
+                 Sampler        &sampler,
+                 PixelFeatures  &features) const override;
+
+    // the camera rays as one packet, then the visibility rays of the lanes that hit as another.
+    void      LiPacket(std::span<const CameraSample> samples,
+                       Sampler                      &sampler,
+                       std::span<glm::vec3>          L,
+                       std::span<PixelFeatures>      features) const override;
+
+private:
+    // albedo at `hit`, with `n` set to the normal facing back along `ray`. Fills `features`.
+    glm::vec3 shade(const Hit             &hit,
+                    const RayDifferential &ray,
+                    glm::vec3             &n,
+                    PixelFeatures         &features) const;
+
+    // cosine weighted visibility ray leaving `hit`.
+    Ray       visibilityRay(const Hit             &hit,
+                            const RayDifferential &ray,
+                            const glm::vec3       &n,
+                            Sampler               &sampler) const;
+
+    std::shared_ptr<const Accel> m_scene;
+    glm::vec3                    m_albedo;
+    glm::vec3                    m_sky;
+    float                        m_maxDistance;
+};
+
+}    // namespace apbr
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+namespace apbr {
+
+// Read only memory mapping of a whole file. Opening costs the same whatever the size: pages are
+// read in by the OS the first time they are touched, and shared with every other process
+// mapping the same file.
+class MappedFile
+{
+public:
+    /// @return nothing if the file doesn't exist, is empty or can't be mapped.
+    static std::optional<MappedFile> open(const std::filesystem::path &path);
+
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    ~MappedFile();
+
+    // page aligned.
+    std::span<const std::byte> bytes() const { return {m_data, m_size}; }
+
+private:
+    MappedFile() = default;
+
+    void unmap();
+
+private:
+    const std::byte *m_data = nullptr;
+    std::size_t      m_size = 0;
+#if defined(_WIN32)
+    void            *m_mapping = nullptr;
+#endif
+};
+
+}    // namespace apbr
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <apbr/Camera.hpp>
+#include <apbr/Film.hpp>
+#include <apbr/Integrator.hpp>
+#include <apbr/Sampler.hpp>
+#include <apbr/Tile.hpp>
+
+namespace apbr {
+
+struct AdaptiveSamplingOptions
+{
+    // off: every pass adds one sample to every pixel, until `timeBudget` runs out if there is
+    // one. On: tiles that reached `targetError` stop, and the others get more samples per pass
+    // the noisier they are.
+    bool  enabled            = false;
+    // samples every pixel gets before the error estimate of its tile is trusted.
+    int   minSamplesPerPixel = 16;
+    // with `enabled`, rendering stops once the `Film::error` of every tile is below this;
+    // 0 never stops.
+    float targetError        = 0.01f;
+    // rendering stops this many seconds after a restart, converged or not; 0 never stops.
+    float timeBudget         = 0.0f;
+    // cap on the samples per pixel a tile gets in one pass, so passes (and with them image
+    // updates and restarts) stay short.
+    int   maxSamplesPerPass  = 16;
+};
+
+// Keeps adding one sample per pixel to a `Film` on a background thread (with the tiles spread
+// over `TaskScheduler::global()`), and publishes the resolved image after every pass.
+//
+// Finished images are handed over through a triple buffer: the render thread always has a
+// buffer of its own to write, the display side always has one to read, and the third holds the
+// latest finished image. Neither side ever waits for the other.
+//
+// Rendering stops when the image is converged or out of time (see `AdaptiveSamplingOptions`)
+// and picks up again when the camera or the scene change.
+class ProgressiveRenderer
+{
+public:
+    using AdaptiveSampling = AdaptiveSamplingOptions;
+
+    struct Image
+    {
+        // RGB floats, bottom row first.
+        std::vector<float> rgb;
+        // mean first hit features in the same layout (see `PixelFeatures`), for denoising.
+        std::vector<float> albedo;
+        std::vector<float> normal;
+        std::vector<float> depth;
+        // mean over all pixels
+        int                samplesPerPixel = 0;
+        // no more passes are coming until the next restart.
+        bool               finished        = false;
+    };
+
+    // pass `n` takes sample `n` of every pixel from (a clone of) `sampler`; by default a
+    // `SobolSampler`, whose prefixes are stratified at every power of two.
+    ProgressiveRenderer(int                               width,
+                        int                               height,
+                        std::shared_ptr<const Integrator> integrator,
+                        const Camera                     &camera,
+                        std::unique_ptr<Sampler>          sampler = nullptr);
+
+    ProgressiveRenderer(const ProgressiveRenderer &)            = delete;
+    ProgressiveRenderer &operator=(const ProgressiveRenderer &) = delete;
+
+    ~ProgressiveRenderer();
+
+    int  width() const { return m_film.width(); }
+
+    int  height() const { return m_film.height(); }
+
+    // restarts accumulation if `camera` differs from the current one.
+    void setCamera(const Camera &camera);
+
+    // swap in a new scene/integrator, e.g. one tracing the next frame of an animation.
+    // Always restarts accumulation.
+    void setIntegrator(std::shared_ptr<const Integrator> integrator);
+
+    // swap in a scene that only moved a little: accumulation carries on from the next pass,
+    // so the image averages the old and new positions (like motion blur) instead of starting
+    // over from one sample per pixel. Resumes a converged image.
+    void updateIntegrator(std::shared_ptr<const Integrator> integrator);
+
+    // also restarts accumulation.
+    void setAdaptiveSampling(const AdaptiveSampling &options);
+
+    /// @brief Latest finished image, or `nullptr` if nothing was published since the last call.
+    /// The image stays valid until the next call. Only one thread may call this.
+    const Image *acquire();
+
+private:
+    void renderLoop();
+
+    // true if pass `pass` started in `generation` should be abandoned. The first pass after
+    // a restart is always finished, so scenes that change every frame (animation) still show
+    // up, one sample per pixel and at most one pass behind.
+    bool abandoned(unsigned generation, int pass) const
+    {
+        return m_stop.load(std::memory_order_relaxed)
+            || (pass > 0 && m_generation.load(std::memory_order_relaxed) != generation);
+    }
+
+    // which of `m_tiles` the tile (or piece of a tile) `tile` lies in, as a row major index
+    // into the grid they cover.
+    int  cellOf(const Tile &tile) const;
+
+private:
+    Film                              m_film;
+    std::vector<Tile>                 m_tiles;
+    std::unique_ptr<const Sampler>    m_sampler;
+
+    // guards the three below; only held to copy them.
+    std::mutex                        m_sceneMutex;
+    Camera                            m_camera;
+    std::shared_ptr<const Integrator> m_integrator;
+    AdaptiveSampling                  m_adaptive;
+    std::atomic<unsigned>             m_generation {0};
+    // `m_integrator` changed without a restart, see `updateIntegrator`.
+    std::atomic<bool>                 m_integratorUpdated {false};
+
+    static constexpr unsigned         freshBit = 4;
+    Image                             m_images[3];
+    // index of the latest published image, `freshBit` set until the display side picks it up.
+    std::atomic<unsigned>             m_ready {2};
+    unsigned                          m_writing = 0;    // render thread only
+    unsigned                          m_reading = 1;    // `acquire` only
+
+    std::atomic<bool>                 m_stop {false};
+    std::thread                       m_thread;
+};
+
+}    // namespace apbr
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <apbr/memory.hpp>
+#include <apbr/TaskScheduler.hpp>
+
+namespace apbr {
+
+// Passes are drawn in this order.
+enum class RenderPass : std::uint8_t {
+    Opaque,
+    // blended, sorted back to front.
+    Transparent,
+    Overlay,
+};
+
+/// @brief Sort key of a draw. From the most to the least significant bits: 8 bits of pass,
+/// 16 of program, 16 of material (say, a texture set) and 24 of depth.
+/// Draws with the same pass, program and material end up next to each other, so the state
+/// changes between them are minimal; inside such a run opaque draws go front to back (early
+/// depth rejection) and transparent ones back to front.
+/// Ids wider than 16 bits are truncated, which only costs some state changes.
+/// @param depth view depth normalized to [0, 1], clamped.
+std::uint64_t makeDrawKey(RenderPass    pass,
+                          std::uint32_t program,
+                          std::uint32_t material,
+                          float         depth);
+
+// Everything `RenderQueue::submit` needs to issue one indexed triangle draw. Plain data, so
+// recording one is a copy into an arena.
+struct DrawCommand
+{
+    static constexpr int maxTextures           = 2;
+
+    std::uint64_t        key                   = 0;
+    GLuint               program               = 0;
+    // with its element buffer bound.
+    GLuint               vertexArray           = 0;
+    // bound to texture units 0, 1, ...; 0 leaves a unit as it is.
+    GLuint               textures[maxTextures] = {};
+    // uniform the transform is uploaded to, or -1 for none.
+    GLint                transformLocation     = -1;
+    glm::mat4            transform {1.0f};
+    GLsizei              indexCount            = 0;
+    // in indices (`GLuint`s) from the start of the element buffer.
+    GLsizei              firstIndex            = 0;
+};
+
+// Draws of a frame, recorded from any number of threads and issued on the thread owning the
+// GL context.
+//
+// Every thread of the scheduler records into a `FrameArena` of its own, so recording takes no
+// locks and, once the arenas have grown to fit a frame, doesn't allocate; `beginFrame` resets
+// them. `submit` sorts all commands by key with a radix sort and skips the program, vertex
+// array and texture bindings that are already in place.
+class RenderQueue
+{
+public:
+    struct Stats
+    {
+        std::size_t draws              = 0;
+        std::size_t programChanges     = 0;
+        std::size_t vertexArrayChanges = 0;
+        std::size_t textureChanges     = 0;
+    };
+
+    explicit RenderQueue(TaskScheduler &scheduler = TaskScheduler::global());
+
+    RenderQueue(const RenderQueue &)            = delete;
+    RenderQueue &operator=(const RenderQueue &) = delete;
+
+    /// @brief Start a frame: frees the commands of the last one, and anything recorded since
+    /// that wasn't submitted. Not while other threads record.
+    void  beginFrame();
+
+    /// @brief Add a draw to the current frame. Safe from the workers of the scheduler and from
+    /// one other thread at a time (see `TaskScheduler::threadIndex`), but not during `submit`.
+    void  record(const DrawCommand &command)
+    {
+        m_arenas[m_scheduler->threadIndex()].commands.push_back(command);
+    }
+
+    /// @brief Sort and issue everything recorded since the last call, then empty the queue.
+    /// GL state changed by the draws (program, vertex array, textures and the active texture
+    /// unit) is left as the last draw set it.
+    Stats submit();
+
+private:
+    // padded to a cache line, so threads recording side by side don't share one.
+    struct alignas(64) Arena
+    {
+        FrameArena                    memory {std::size_t {16} << 10};
+        std::pmr::vector<DrawCommand> commands {&memory};
+    };
+
+    struct SortItem
+    {
+        std::uint64_t key;
+        std::uint32_t arena;
+        std::uint32_t index;
+    };
+
+    TaskScheduler        *m_scheduler;
+    std::vector<Arena>    m_arenas;
+    // radix sort buffers, kept between frames.
+    std::vector<SortItem> m_items;
+    std::vector<SortItem> m_scratch;
+};
+
+}    // namespace apbr
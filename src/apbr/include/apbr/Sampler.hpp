@@ -0,0 +1,258 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include <apbr/rng.hpp>
+
+namespace apbr {
+
+// Sample values in [0, 1) for the integrators, following chapter 8 of the PBR book: every pixel
+// sample is a point in a high dimensional cube, consumed one or two dimensions at a time.
+//
+// A sampler is stateful and used by one thread at a time; `clone` one per thread or task.
+class Sampler
+{
+public:
+    virtual ~Sampler() = default;
+
+    // the count the sampler was set up for. Later sample indices still work, but the points
+    // past it are not as evenly spread over the pixel sample as a whole.
+    virtual int                      samplesPerPixel() const = 0;
+
+    // `dimension` skips ahead, e.g. to continue a path from a known vertex.
+    virtual void                     startPixelSample(glm::ivec2 pixel,
+                                                      int        sampleIndex,
+                                                      int        dimension = 0) = 0;
+
+    virtual float                    get1D()                                     = 0;
+
+    virtual glm::vec2                get2D()                                     = 0;
+
+    // offset of the sample within its pixel. Call it first, before `get1D`/`get2D`.
+    virtual glm::vec2                getPixel2D()                                = 0;
+
+    virtual std::unique_ptr<Sampler> clone() const                               = 0;
+};
+
+// uniform random samples; the baseline every other sampler should beat.
+class IndependentSampler final : public Sampler
+{
+public:
+    explicit IndependentSampler(int samplesPerPixel, std::uint64_t seed = 0)
+        : m_samplesPerPixel {samplesPerPixel},
+          m_seed {seed}
+    {
+    }
+
+    int       samplesPerPixel() const override { return m_samplesPerPixel; }
+
+    void      startPixelSample(glm::ivec2 pixel,
+                               int        sampleIndex,
+                               int        dimension = 0) override;
+
+    float     get1D() override { return m_rng.uniformFloat(); }
+
+    glm::vec2 get2D() override
+    {
+        const auto x = m_rng.uniformFloat();
+        return {x, m_rng.uniformFloat()};
+    }
+
+    glm::vec2 getPixel2D() override { return get2D(); }
+
+    std::unique_ptr<Sampler> clone() const override
+    {
+        return std::make_unique<IndependentSampler>(*this);
+    }
+
+private:
+    int           m_samplesPerPixel;
+    std::uint64_t m_seed;
+    RNG           m_rng;
+};
+
+// `xSamples` x `ySamples` strata per pixel (and `xSamples * ySamples` in 1D), visited in a
+// different random order for every pixel and dimension.
+class StratifiedSampler final : public Sampler
+{
+public:
+    StratifiedSampler(int           xSamples,
+                      int           ySamples,
+                      bool          jitter = true,
+                      std::uint64_t seed   = 0)
+        : m_xSamples {xSamples},
+          m_ySamples {ySamples},
+          m_jitter {jitter},
+          m_seed {seed}
+    {
+    }
+
+    int       samplesPerPixel() const override { return m_xSamples * m_ySamples; }
+
+    void      startPixelSample(glm::ivec2 pixel,
+                               int        sampleIndex,
+                               int        dimension = 0) override;
+
+    float     get1D() override;
+
+    glm::vec2 get2D() override;
+
+    glm::vec2 getPixel2D() override { return get2D(); }
+
+    std::unique_ptr<Sampler> clone() const override
+    {
+        return std::make_unique<StratifiedSampler>(*this);
+    }
+
+private:
+    // the stratum this pixel sample uses in the current dimension.
+    std::uint32_t stratum();
+
+private:
+    int           m_xSamples;
+    int           m_ySamples;
+    bool          m_jitter;
+    std::uint64_t m_seed;
+
+    glm::ivec2    m_pixel {0};
+    int           m_sampleIndex = 0;
+    int           m_dimension   = 0;
+    RNG           m_rng;
+};
+
+// One Halton sequence across the whole image: the first two dimensions are scaled up to cover
+// up to 128 x 128 pixels, and each pixel gets the sample indices that land in it. The remaining
+// dimensions are Owen scrambled.
+class HaltonSampler final : public Sampler
+{
+public:
+    HaltonSampler(int samplesPerPixel, glm::ivec2 resolution, std::uint64_t seed = 0);
+
+    int       samplesPerPixel() const override { return m_samplesPerPixel; }
+
+    void      startPixelSample(glm::ivec2 pixel,
+                               int        sampleIndex,
+                               int        dimension = 0) override;
+
+    float     get1D() override { return sampleDimension(m_dimension++); }
+
+    glm::vec2 get2D() override;
+
+    glm::vec2 getPixel2D() override;
+
+    std::unique_ptr<Sampler> clone() const override
+    {
+        return std::make_unique<HaltonSampler>(*this);
+    }
+
+private:
+    float sampleDimension(int dimension) const;
+
+private:
+    static constexpr int maxResolution = 128;
+
+    int                  m_samplesPerPixel;
+    std::uint64_t        m_seed;
+    // per axis: base^exponent, the smallest power covering the image (up to `maxResolution`).
+    std::uint64_t        m_baseScales[2];
+    int                  m_baseExponents[2];
+    // inverse of the other axis' scale modulo this axis' scale.
+    std::uint64_t        m_multInverse[2];
+
+    std::uint64_t        m_haltonIndex = 0;
+    int                  m_dimension   = 0;
+};
+
+// Owen scrambled Sobol points, scrambled differently per pixel. Each pixel runs through the
+// points in order, so every power of two prefix is well stratified, which suits progressive
+// rendering. Past `sobolDimensions` the table is reused with the point order shuffled.
+class SobolSampler final : public Sampler
+{
+public:
+    explicit SobolSampler(int samplesPerPixel, std::uint64_t seed = 0)
+        : m_samplesPerPixel {samplesPerPixel},
+          m_seed {seed}
+    {
+    }
+
+    int       samplesPerPixel() const override { return m_samplesPerPixel; }
+
+    void      startPixelSample(glm::ivec2 pixel,
+                               int        sampleIndex,
+                               int        dimension = 0) override;
+
+    float     get1D() override { return sampleDimension(m_dimension++); }
+
+    glm::vec2 get2D() override
+    {
+        const auto x = sampleDimension(m_dimension);
+        const auto y = sampleDimension(m_dimension + 1);
+        m_dimension += 2;
+        return {x, y};
+    }
+
+    glm::vec2 getPixel2D() override { return get2D(); }
+
+    std::unique_ptr<Sampler> clone() const override
+    {
+        return std::make_unique<SobolSampler>(*this);
+    }
+
+private:
+    float sampleDimension(int dimension) const;
+
+private:
+    int           m_samplesPerPixel;
+    std::uint64_t m_seed;
+
+    std::uint64_t m_pixelHash   = 0;
+    std::uint32_t m_sampleIndex = 0;
+    int           m_dimension   = 0;
+};
+
+// Ahmed and Wonka's screen space Sobol sampler ("Screen-Space Blue-Noise Diffusion of Monte
+// Carlo Sampling Error via Hierarchical Ordering of Pixels"): one 2D Sobol sequence over the
+// whole image, with pixels and samples ordered along a Morton curve and the order shuffled per
+// dimension. The error comes out as blue noise across neighbouring pixels.
+//
+// `samplesPerPixel` is rounded up to a power of two. Later sample indices start another round
+// with a different seed.
+class ZSobolSampler final : public Sampler
+{
+public:
+    ZSobolSampler(int samplesPerPixel, glm::ivec2 resolution, std::uint64_t seed = 0);
+
+    int       samplesPerPixel() const override { return 1 << m_log2SamplesPerPixel; }
+
+    void      startPixelSample(glm::ivec2 pixel,
+                               int        sampleIndex,
+                               int        dimension = 0) override;
+
+    float     get1D() override;
+
+    glm::vec2 get2D() override;
+
+    glm::vec2 getPixel2D() override { return get2D(); }
+
+    std::unique_ptr<Sampler> clone() const override
+    {
+        return std::make_unique<ZSobolSampler>(*this);
+    }
+
+private:
+    std::uint64_t sampleIndex() const;
+
+private:
+    int           m_log2SamplesPerPixel;
+    int           m_base4Digits;
+    std::uint64_t m_seed;
+
+    std::uint64_t m_roundSeed   = 0;
+    std::uint64_t m_mortonIndex = 0;
+    int           m_dimension   = 0;
+};
+
+}    // namespace apbr
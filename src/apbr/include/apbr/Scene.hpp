@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace apbr {
+
+// Transform hierarchy, stored data oriented: every field of the nodes is an array of its own,
+// and each of the 16 matrix elements of the local and world transforms is one too. Slots are
+// sorted by depth (then by parent), so `update` walks the arrays front to back: parents are
+// always done before their children, and siblings are neighbours.
+//
+// `setLocal` marks a node dirty; `update` spreads that to the subtree and recomputes only the
+// world transforms of dirty nodes, `simd::width` nodes at a time, with large levels spread over
+// `TaskScheduler::global()`.
+//
+// The rasterizer reads `world` for its draws and `Accel::setTransforms` takes the nodes of its
+// instances, so both see the same transforms.
+class Scene
+{
+public:
+    // handle of a node; stays valid while the scene lives.
+    using Node = std::uint32_t;
+
+    static constexpr Node none = ~Node {0};
+
+    Scene() = default;
+
+    std::size_t size() const { return m_slot.size(); }
+
+    /// @brief Add a node below `parent` (or a root for `none`). Its world transform is only
+    /// valid after the next `update`.
+    Node        addNode(const glm::mat4 &local = glm::mat4 {1.0f}, Node parent = none);
+
+    Node        parent(Node node) const;
+
+    // 0 for roots.
+    int         depth(Node node) const { return static_cast<int>(m_depth[m_slot[node]]); }
+
+    glm::mat4   local(Node node) const { return load(m_local, m_slot[node]); }
+
+    void        setLocal(Node node, const glm::mat4 &local);
+
+    // object to world, as of the last `update`.
+    glm::mat4   world(Node node) const { return load(m_world, m_slot[node]); }
+
+    /// @brief Bring the world transforms of all dirty nodes and their subtrees up to date.
+    /// @return the number of world transforms recomputed.
+    std::size_t update();
+
+private:
+    // one array per matrix element, column major (element `4 * column + row`).
+    using Planes = std::array<std::vector<float>, 16>;
+
+    static glm::mat4 load(const Planes &planes, std::size_t slot);
+
+    static void      store(Planes &planes, std::size_t slot, const glm::mat4 &m);
+
+    // restore the slot order after nodes were added out of order.
+    void             sort();
+
+    // world transforms of the slots `[first, last)`, all of one depth below the roots.
+    void             composeRange(std::size_t first, std::size_t last);
+
+private:
+    // slot of every node, and the other way around.
+    std::vector<std::uint32_t> m_slot;
+    std::vector<Node>          m_node;
+
+    // the rest is indexed by slot.
+    std::vector<std::uint32_t> m_parent;    // slot of the parent, `none` for roots
+    std::vector<std::uint32_t> m_depth;
+    std::vector<std::uint8_t>  m_dirty;
+    Planes                     m_local;
+    Planes                     m_world;
+
+    // first slot of every depth, and one past the last slot.
+    std::vector<std::size_t>   m_levels {0};
+    bool                       m_sorted = true;
+};
+
+}    // namespace apbr
@@ -2,6 +2,7 @@
 
 #include <glad/glad.h>
 
+#include <memory_resource>
 #include <string_view>
 #include <string>
 
@@ -18,7 +19,7 @@ public:
     };
 
     Shader(Type type);
-    Shader(Type type, const std::string& source);
+    Shader(Type type, std::string_view source);
 
     ~Shader()
     {
@@ -48,17 +49,23 @@ public:
     /// @brief Provide a shader source to compile the shader. (For example: when constructed with the `Shader(Type)` overload).
     /// @param source relevant shader source code.
     /// @return Compilation status.
-    bool compile(const std::string& source)
+    bool compile(std::string_view source)
     {
-        auto source_cstr = source.c_str();
-        glShaderSource(m_handle, 1, &source_cstr, nullptr);
+        const auto *data   = source.data();
+        const auto  length = static_cast<GLint>(source.size());
+        glShaderSource(m_handle, 1, &data, &length);
         return compile();
     }
 
 public:
     // factory functions
 
-    static Shader from_file(Type type, const std::string &filepath);
+    /// @brief Read and compile the shader source at `filepath`.
+    /// @param memory where the source is kept while compiling, e.g. a `FrameArena`.
+    static Shader from_file(
+        Type                       type,
+        const std::string         &filepath,
+        std::pmr::memory_resource *memory = std::pmr::get_default_resource());
 
     static Shader vertexShader(const char *const source)
     {
@@ -70,14 +77,18 @@ public:
         return Shader {Type::Fragment, source};
     }
 
-    static Shader vertexShaderFromFile(const std::string &filepath)
+    static Shader vertexShaderFromFile(
+        const std::string         &filepath,
+        std::pmr::memory_resource *memory = std::pmr::get_default_resource())
     {
-        return Shader::from_file(Type::Vertex, filepath);
+        return Shader::from_file(Type::Vertex, filepath, memory);
     }
 
-    static Shader fragmentShaderFromFile(const std::string &filepath)
+    static Shader fragmentShaderFromFile(
+        const std::string         &filepath,
+        std::pmr::memory_resource *memory = std::pmr::get_default_resource())
     {
-        return Shader::from_file(Type::Fragment, filepath);
+        return Shader::from_file(Type::Fragment, filepath, memory);
     }
 
 private:
@@ -19,9 +19,14 @@ public:
 
     void attach(const Shader &shader) { glAttachShader(m_handle, shader.id()); }
 
+    GLint getUniformLocation(const char *name) const
+    {
+        return glGetUniformLocation(m_handle, name);
+    }
+
     GLint getUniformLocation(const std::string &name) const
     {
-        return glGetUniformLocation(m_handle, name.c_str());
+        return getUniformLocation(name.c_str());
     }
 
     bool link()
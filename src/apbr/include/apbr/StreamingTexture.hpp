@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <span>
+
+namespace apbr {
+
+// RGB float texture that gets new contents from the CPU every few frames.
+// Uploads go through two pixel unpack buffers: the texture copies from the one filled on the
+// previous update while the CPU fills the other, so `update` never waits for the GPU to finish
+// reading. The price is one update of latency: call `flush` on frames without a new image so
+// the last one still makes it into the texture. The first image is uploaded directly.
+class StreamingTexture
+{
+public:
+    StreamingTexture(int width, int height);
+
+    StreamingTexture(const StreamingTexture &)            = delete;
+    StreamingTexture &operator=(const StreamingTexture &) = delete;
+
+    ~StreamingTexture();
+
+    GLuint handle() const { return m_texture; }
+
+    int    width() const { return m_width; }
+
+    int    height() const { return m_height; }
+
+    /// @brief Queue new contents for the texture.
+    /// @param rgb `width() * height() * 3` floats, bottom row first.
+    void   update(std::span<const float> rgb);
+
+    /// @brief Copy the last queued update into the texture, if it isn't there yet.
+    void   flush();
+
+private:
+    int    m_width;
+    int    m_height;
+    GLuint m_texture = 0;
+    GLuint m_pbo[2]  = {0, 0};
+    // PBO the CPU writes next; the other one holds the previous update.
+    int    m_index   = 0;
+    bool   m_pending = false;
+    // nothing but black has been uploaded yet.
+    bool   m_empty   = true;
+};
+
+}    // namespace apbr
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <apbr/Tile.hpp>
+
+namespace apbr {
+
+// Tasks submitted through `TaskScheduler::run` with the same group can be waited on together.
+class TaskGroup
+{
+public:
+    TaskGroup() = default;
+
+    TaskGroup(const TaskGroup &)            = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    bool done() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class TaskScheduler;
+
+    std::atomic<std::size_t> m_pending {0};
+    std::mutex               m_errorMutex;
+    // first exception thrown by a task of the group, rethrown by `TaskScheduler::wait`.
+    std::exception_ptr       m_error;
+};
+
+// Thread pool with one work-stealing deque per worker. Workers push and pop their own
+// deque at the back and steal from the front of the others', so the oldest (and usually
+// largest) pieces of work move between threads. Threads that are not workers submit through
+// a shared queue and, while they `wait`, only run the tasks of the group they wait on that are
+// still in it. They never steal, so a thread that must stay responsive (like the one owning
+// the GL context) doesn't end up running someone else's long task.
+//
+// Use `TaskScheduler::global()` so the renderer, BVH builds and texture loading share one pool.
+class TaskScheduler
+{
+public:
+    // `void()` callable of a queued task. Callables of up to `inlineSize` bytes, like lambdas
+    // capturing a few references and indices, are stored in place, so queuing them doesn't
+    // allocate; larger ones go to the heap.
+    class Task
+    {
+    public:
+        static constexpr std::size_t inlineSize = 6 * sizeof(void *);
+
+        Task() = default;
+
+        template<typename Fn>
+            requires(!std::is_same_v<std::remove_cvref_t<Fn>, Task>
+                     && std::is_invocable_v<std::remove_cvref_t<Fn> &>)
+        Task(Fn &&fn)
+        {
+            using F = std::remove_cvref_t<Fn>;
+            if constexpr (fitsInline<F>) {
+                ::new (static_cast<void *>(m_storage)) F(std::forward<Fn>(fn));
+                m_ops = &inlineOps<F>;
+            } else {
+                ::new (static_cast<void *>(m_storage)) F *(new F(std::forward<Fn>(fn)));
+                m_ops = &heapOps<F>;
+            }
+        }
+
+        Task(Task &&other) noexcept : m_ops {std::exchange(other.m_ops, nullptr)}
+        {
+            if (m_ops)
+                m_ops->relocate(other.m_storage, m_storage);
+        }
+
+        Task &operator=(Task &&other) noexcept
+        {
+            if (this != &other) {
+                reset();
+                m_ops = std::exchange(other.m_ops, nullptr);
+                if (m_ops)
+                    m_ops->relocate(other.m_storage, m_storage);
+            }
+            return *this;
+        }
+
+        ~Task() { reset(); }
+
+        void operator()() { m_ops->invoke(m_storage); }
+
+    private:
+        struct Ops
+        {
+            void (*invoke)(void *storage);
+            // move constructs into `to` and destroys what is left in `from`.
+            void (*relocate)(void *from, void *to);
+            void (*destroy)(void *storage);
+        };
+
+        template<typename F>
+        static constexpr bool fitsInline = sizeof(F) <= inlineSize
+                                        && alignof(F) <= alignof(std::max_align_t)
+                                        && std::is_nothrow_move_constructible_v<F>;
+
+        template<typename F>
+        static constexpr Ops inlineOps {
+            [](void *storage) { (*static_cast<F *>(storage))(); },
+            [](void *from, void *to) {
+                auto *f = static_cast<F *>(from);
+                ::new (to) F(std::move(*f));
+                f->~F();
+            },
+            [](void *storage) { static_cast<F *>(storage)->~F(); }};
+
+        // the storage holds an `F *`.
+        template<typename F>
+        static constexpr Ops heapOps {
+            [](void *storage) { (**static_cast<F **>(storage))(); },
+            [](void *from, void *to) { ::new (to) F *(*static_cast<F **>(from)); },
+            [](void *storage) { delete *static_cast<F **>(storage); }};
+
+        void reset()
+        {
+            if (m_ops)
+                m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+
+    private:
+        alignas(std::max_align_t) std::byte m_storage[inlineSize];
+        const Ops                          *m_ops = nullptr;
+    };
+
+    // `workerCount` threads are spawned; the thread calling `wait` works as well.
+    explicit TaskScheduler(unsigned workerCount = defaultWorkerCount());
+
+    TaskScheduler(const TaskScheduler &)            = delete;
+    TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+    ~TaskScheduler();
+
+    static TaskScheduler &global();
+
+    static unsigned       defaultWorkerCount();
+
+    // number of distinct `threadIndex()` values, for sizing per-thread data.
+    unsigned threadCount() const
+    {
+        return static_cast<unsigned>(m_queues.size()) + 1;
+    }
+
+    // index of the calling worker in `[0, threadCount() - 1)`. All other threads share the
+    // last index, so per-thread data indexed by it must only be touched by one of them at a time.
+    unsigned threadIndex() const;
+
+    // number of workers currently waiting for work.
+    unsigned idleCount() const
+    {
+        return m_idle.load(std::memory_order_relaxed);
+    }
+
+    void run(TaskGroup &group, Task task);
+
+    // runs queued tasks until all tasks of `group` are done, then rethrows the first
+    // exception one of them threw. Workers run any task; other threads only those of `group`.
+    void wait(TaskGroup &group);
+
+    /// @brief Call `body(first, last)` over chunks of `[begin, end)` in parallel and wait for them.
+    /// Ranges are split lazily: a thread only splits off half of its remaining range while its
+    /// own deque is empty, i.e. while others may be starved. Uneven work is balanced without
+    /// cutting everything into `grain` sized tasks up front.
+    template<typename Body>
+    void parallelFor(std::size_t begin,
+                     std::size_t end,
+                     std::size_t grain,
+                     Body      &&body);
+
+    /// @brief Call `body(tile)` for every tile in parallel and wait for them.
+    /// While workers are idle, tiles are halved down to `minTileSize` before running them, so
+    /// the last and most expensive tiles of a frame get spread over all cores.
+    template<typename Body>
+    void parallelForTiles(std::span<const Tile> tiles,
+                          int                   minTileSize,
+                          Body                &&body);
+
+private:
+    struct QueuedTask
+    {
+        Task       fn;
+        TaskGroup *group;
+    };
+
+    struct WorkQueue
+    {
+        mutable std::mutex                     mutex;
+        // nodes of `tasks`, reused once the queue has been as long as it gets. Guarded by
+        // `mutex`.
+        std::pmr::unsynchronized_pool_resource pool;
+        std::pmr::deque<QueuedTask>            tasks {&pool};
+    };
+
+    // true if the calling thread has queued work that others could steal.
+    bool hasLocalWork() const;
+
+    void push(QueuedTask task);
+
+    // `group` restricts what a thread that is not a worker may run; workers ignore it.
+    bool tryRunOne(const TaskGroup *group = nullptr);
+
+    void workerLoop(unsigned index);
+
+    static void execute(QueuedTask &task);
+
+private:
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    // tasks submitted from threads that are not workers.
+    WorkQueue                               m_shared;
+    std::vector<std::thread>                m_threads;
+
+    std::atomic<std::size_t>                m_queued {0};
+    std::atomic<unsigned>                   m_idle {0};
+    std::atomic<bool>                       m_stop {false};
+    std::mutex                              m_sleepMutex;
+    std::condition_variable                 m_wake;
+};
+
+template<typename Body>
+void TaskScheduler::parallelFor(std::size_t begin,
+                                std::size_t end,
+                                std::size_t grain,
+                                Body      &&body)
+{
+    if (begin >= end)
+        return;
+
+    grain = std::max<std::size_t>(grain, 1);
+    // nothing to split, so skip the task and its allocation.
+    if (end - begin <= grain) {
+        body(begin, end);
+        return;
+    }
+
+    // recursive through `self` rather than a `std::function`, so the tasks only capture a
+    // reference and two indices and fit in a `Task`.
+    TaskGroup group;
+    auto      process = [&](auto &self, std::size_t first, std::size_t last) -> void {
+        while (last - first > grain) {
+            if (hasLocalWork()) {
+                body(first, first + grain);
+                first += grain;
+                continue;
+            }
+            const auto mid = first + (last - first) / 2;
+            run(group, [&self, mid, last] { self(self, mid, last); });
+            last = mid;
+        }
+        body(first, last);
+    };
+
+    // queued like the pieces split off later, so exceptions end up in `group` as well.
+    run(group, [&process, begin, end] { process(process, begin, end); });
+    wait(group);
+}
+
+template<typename Body>
+void TaskScheduler::parallelForTiles(std::span<const Tile> tiles,
+                                     int                   minTileSize,
+                                     Body                &&body)
+{
+    TaskGroup group;
+    auto      process = [&](auto &self, Tile tile) -> void {
+        while (idleCount() > 0 && !hasLocalWork()
+               && std::max(tile.width(), tile.height()) >= 2 * minTileSize) {
+            const auto other = splitTile(tile);
+            run(group, [&self, other] { self(self, other); });
+        }
+        body(tile);
+    };
+
+    // queued in order, and stolen from the front, so threads start out on neighbouring tiles.
+    for (const auto &tile : tiles)
+        run(group, [&process, tile] { process(process, tile); });
+    wait(group);
+}
+
+}    // namespace apbr
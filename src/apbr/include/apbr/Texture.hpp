@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <apbr/TextureCache.hpp>
+
+namespace apbr {
+
+enum class TextureFilter : int {
+    Point,
+    Bilinear,
+    Trilinear,
+    // elliptically weighted average (Heckbert), anisotropic.
+    EWA,
+};
+
+// Where a lookup lands and how far the texture coordinates move to the neighbouring pixels.
+// Usually from `Accel::textureFootprint`.
+struct TextureFootprint
+{
+    glm::vec2 st {0.0f};
+    glm::vec2 dstdx {0.0f};
+    glm::vec2 dstdy {0.0f};
+};
+
+// MIP mapped RGBA8 image for the CPU integrators. Every level is cut into 32 x 32 blocks with
+// the texels of a block in Morton order, so filter footprints, which are small squares or
+// ellipses, touch few cache lines even when rays arrive in no particular order.
+//
+// A texture either holds all its blocks or pages them in from a cache file (see `writeCache`)
+// through a `TextureCache`, so a texture set larger than memory can still be rendered. Lookups
+// are safe from many threads either way.
+//
+// Like `glTexImage2D`, the first row of pixels is at `t = 0`. Coordinates wrap around (repeat).
+class Texture
+{
+public:
+    static constexpr int blockSize = textureBlockSize;
+
+    /// @brief Copy 8 bit pixels (as loaded by stb_image) and build the MIP chain.
+    /// @param channels 1 (gray), 2 (gray, alpha), 3 (RGB) or 4 (RGBA).
+    /// @param srgb whether the color channels are sRGB encoded. Lookups return linear values.
+    Texture(int                          width,
+            int                          height,
+            int                          channels,
+            std::span<const std::uint8_t> pixels,
+            bool                         srgb = true);
+
+    /// @brief Open a file written by `writeCache`, paging blocks in through `cache` on demand.
+    /// @return nothing if the file can't be read.
+    static std::optional<Texture>
+    fromCache(const std::filesystem::path &path, std::shared_ptr<TextureCache> cache);
+
+    /// @brief Write all levels, block by block, for `fromCache`. Only works on textures that
+    /// hold their blocks.
+    bool          writeCache(const std::filesystem::path &path) const;
+
+    int           width() const { return m_levels.front().width; }
+
+    int           height() const { return m_levels.front().height; }
+
+    int           levels() const { return static_cast<int>(m_levels.size()); }
+
+    bool          paged() const { return m_cache != nullptr; }
+
+    TextureFilter filter() const { return m_filter; }
+
+    void          setFilter(TextureFilter filter) { m_filter = filter; }
+
+    // EWA clamps longer ellipses, trading blur for speed.
+    void          setMaxAnisotropy(float ratio) { m_maxAnisotropy = ratio; }
+
+    // a single texel, linear RGBA.
+    glm::vec4     texel(int level, int x, int y) const;
+
+    /// @brief Filtered lookup with the current `filter()`, linear RGBA.
+    glm::vec4     lookup(const TextureFootprint &footprint) const;
+
+private:
+    struct Level
+    {
+        int         width   = 0;
+        int         height  = 0;
+        int         blocksX = 0;
+        std::size_t firstBlock = 0;
+    };
+
+    // the block a lookup is reading from; most filters stay inside one block, so this saves
+    // the cache a lock per texel.
+    class Fetch;
+
+    struct PagedFile;
+
+    Texture() = default;
+
+    // fills `m_levels`, returns the number of blocks of all levels.
+    std::size_t         setLevels(int width, int height);
+
+    std::size_t         blockIndex(int level, int x, int y) const;
+
+    glm::vec4           texel(Fetch &fetch, int level, int x, int y) const;
+
+    glm::vec4           bilerp(Fetch &fetch, int level, glm::vec2 st) const;
+
+    glm::vec4           ewa(Fetch     &fetch,
+                            int        level,
+                            glm::vec2  st,
+                            glm::vec2  dst0,
+                            glm::vec2  dst1) const;
+
+    void                buildLevel(int level);
+
+private:
+    std::vector<Level>            m_levels;
+    bool                          m_srgb          = true;
+    TextureFilter                 m_filter        = TextureFilter::EWA;
+    float                         m_maxAnisotropy = 8.0f;
+
+    // resident blocks of all levels, level by level. Empty for paged textures.
+    std::vector<TextureBlock>     m_blocks;
+
+    std::shared_ptr<TextureCache> m_cache;
+    std::shared_ptr<PagedFile>    m_file;
+};
+
+}    // namespace apbr
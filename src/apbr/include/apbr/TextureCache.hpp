@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace apbr {
+
+// texels are stored in square blocks of this size, Morton ordered inside. With RGBA8 texels a
+// block is 4 KiB, one page.
+inline constexpr int textureBlockSize = 32;
+
+struct TextureBlock
+{
+    std::uint32_t texels[textureBlockSize * textureBlockSize];
+};
+
+// Bounded, thread safe LRU cache of texture blocks, shared by all paged `Texture`s. Blocks are
+// handed out as `shared_ptr`s, so evicting one never pulls it from under a lookup still using it.
+class TextureCache
+{
+public:
+    // fills a block on a miss, e.g. from a file. Returns false on failure.
+    using Loader = std::function<bool(TextureBlock &)>;
+
+    explicit TextureCache(std::size_t capacityBytes);
+
+    TextureCache(const TextureCache &)            = delete;
+    TextureCache &operator=(const TextureCache &) = delete;
+
+    // in blocks
+    std::size_t   capacity() const { return m_shardCapacity * shardCount; }
+
+    std::uint64_t hits() const;
+
+    std::uint64_t misses() const;
+
+    // an id to build keys from, one per data source (say a cache file).
+    std::uint64_t newSource();
+
+    /// @brief Block `index` of `source`, loaded with `load` on a miss.
+    /// @return `nullptr` if it wasn't cached and `load` failed.
+    std::shared_ptr<const TextureBlock>
+    block(std::uint64_t source, std::uint64_t index, const Loader &load);
+
+private:
+    // independently locked parts of the cache, so threads missing on different blocks rarely
+    // wait for each other.
+    static constexpr std::size_t shardCount = 16;
+
+    struct Shard
+    {
+        struct Entry
+        {
+            std::shared_ptr<const TextureBlock>     block;
+            std::pmr::list<std::uint64_t>::iterator position;
+        };
+
+        mutable std::mutex                            mutex;
+        // nodes of `order` and `entries`; those of evicted blocks are reused by the next
+        // insert, so a full cache stops going to the heap for them. Guarded by `mutex`.
+        std::pmr::unsynchronized_pool_resource        pool;
+        // most recently used first
+        std::pmr::list<std::uint64_t>                 order {&pool};
+        std::pmr::unordered_map<std::uint64_t, Entry> entries {&pool};
+        std::uint64_t                                 hits   = 0;
+        std::uint64_t                                 misses = 0;
+    };
+
+    std::size_t        m_shardCapacity;
+    std::vector<Shard> m_shards;
+    std::mutex         m_sourceMutex;
+    std::uint64_t      m_nextSource = 0;
+};
+
+}    // namespace apbr
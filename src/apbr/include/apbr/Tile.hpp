@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace apbr {
+
+// half open pixel rectangle [x0, x1) x [y0, y1)
+struct Tile
+{
+    int  x0 = 0;
+    int  y0 = 0;
+    int  x1 = 0;
+    int  y1 = 0;
+
+    int  width() const { return x1 - x0; }
+
+    int  height() const { return y1 - y0; }
+
+    int  area() const { return width() * height(); }
+
+    bool empty() const { return x1 <= x0 || y1 <= y0; }
+};
+
+enum class TileOrder : int {
+    Scanline,
+    Morton,
+    Hilbert,
+};
+
+// interleave the lower 16 bits of `x` and `y`.
+constexpr std::uint32_t mortonEncode(std::uint32_t x, std::uint32_t y)
+{
+    auto spread = [](std::uint32_t v) {
+        v &= 0x0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+/// @brief Cover a `width` x `height` image with square tiles, ordered along a space filling curve
+/// so that consecutive tiles (and the threads working on them) touch neighbouring memory.
+/// Tiles on the right and bottom border are clipped to the image.
+std::vector<Tile> makeTiles(int       width,
+                            int       height,
+                            int       tileSize,
+                            TileOrder order = TileOrder::Hilbert);
+
+// split `tile` in half along its longer side. `tile` keeps the first half, the second is returned.
+Tile splitTile(Tile &tile);
+
+}    // namespace apbr
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <apbr/BVH.hpp>
+#include <apbr/geometry.hpp>
+
+namespace apbr {
+
+struct Hit
+{
+    float         t = infinity;
+    // barycentrics of the second and third vertex.
+    float         b1 = 0.0f;
+    float         b2 = 0.0f;
+    std::uint32_t primitive = BVH::invalid;
+    // set by `Accel`, the instance the triangle belongs to.
+    std::uint32_t instance  = BVH::invalid;
+
+    bool          valid() const { return primitive != BVH::invalid; }
+};
+
+// per lane version of `Hit` for `RayPacket`s. The distance lives in `RayPacket::tMax`.
+struct PacketHit
+{
+    float         b1[RayPacket::size];
+    float         b2[RayPacket::size];
+    std::uint32_t primitive[RayPacket::size];
+    // set by `Accel`.
+    std::uint32_t instance[RayPacket::size];
+
+    Hit           hit(const RayPacket &packet, int lane) const
+    {
+        return Hit {packet.tMax[lane], b1[lane], b2[lane], primitive[lane], instance[lane]};
+    }
+};
+
+// Indexed triangle mesh with its own BVH over the triangles.
+class TriangleMesh
+{
+public:
+    /// @param uvs optional texture coordinates, one per position.
+    TriangleMesh(std::vector<glm::vec3>     positions,
+                 std::vector<std::uint32_t> indices,
+                 std::vector<glm::vec2>     uvs = {});
+
+    std::size_t triangleCount() const { return m_indices.size() / 3; }
+
+    Triangle    triangle(std::uint32_t i) const
+    {
+        return Triangle {m_positions[m_indices[3 * i]],
+                         m_positions[m_indices[3 * i + 1]],
+                         m_positions[m_indices[3 * i + 2]]};
+    }
+
+    bool        hasUVs() const { return !m_uvs.empty(); }
+
+    // texture coordinates of the vertices of triangle `i`. Without UVs every triangle gets
+    // (0, 0), (1, 0), (1, 1), like pbrt.
+    std::array<glm::vec2, 3> triangleUVs(std::uint32_t i) const
+    {
+        if (!hasUVs())
+            return {glm::vec2 {0.0f, 0.0f}, glm::vec2 {1.0f, 0.0f}, glm::vec2 {1.0f, 1.0f}};
+        return {m_uvs[m_indices[3 * i]],
+                m_uvs[m_indices[3 * i + 1]],
+                m_uvs[m_indices[3 * i + 2]]};
+    }
+
+    const BVH &bvh() const { return m_bvh; }
+
+    Bounds3f   bounds() const { return m_bvh.bounds(); }
+
+    // closest hit. Shrinks `ray.tMax` to the hit distance.
+    bool       intersect(Ray &ray, Hit &hit) const;
+
+    bool       occluded(const Ray &ray) const;
+
+    // closest hit for every active lane. Lanes without a hit get `BVH::invalid` as primitive.
+    void          intersect(RayPacket &packet, PacketHit &hit) const;
+
+    // shadow rays. Returns the bits of the occluded lanes.
+    std::uint32_t occluded(const RayPacket &packet) const;
+
+private:
+    std::vector<glm::vec3>     m_positions;
+    std::vector<std::uint32_t> m_indices;
+    std::vector<glm::vec2>     m_uvs;
+    BVH                        m_bvh;
+};
+
+}    // namespace apbr
@@ -1,8 +1,33 @@
 #pragma once
 
+#include <apbr/Accel.hpp>
+#include <apbr/BVH.hpp>
+#include <apbr/Camera.hpp>
 #include <apbr/color.hpp>
+#include <apbr/Culler.hpp>
+#include <apbr/Denoiser.hpp>
+#include <apbr/Film.hpp>
+#include <apbr/geometry.hpp>
+#include <apbr/IBL.hpp>
+#include <apbr/Integrator.hpp>
 #include <apbr/Logger.hpp>
+#include <apbr/lowdiscrepancy.hpp>
+#include <apbr/MappedFile.hpp>
+#include <apbr/memory.hpp>
+#include <apbr/png.hpp>
+#include <apbr/ProgressiveRenderer.hpp>
+#include <apbr/RenderQueue.hpp>
+#include <apbr/rng.hpp>
+#include <apbr/Sampler.hpp>
+#include <apbr/Scene.hpp>
+#include <apbr/sampling.hpp>
 #include <apbr/Shader.hpp>
 #include <apbr/ShaderProgram.hpp>
+#include <apbr/StreamingTexture.hpp>
+#include <apbr/TaskScheduler.hpp>
+#include <apbr/Texture.hpp>
+#include <apbr/TextureCache.hpp>
+#include <apbr/Tile.hpp>
+#include <apbr/TriangleMesh.hpp>
 #include <apbr/Window.hpp>
 #include <apbr/misc.hpp>
\ No newline at end of file
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+namespace apbr {
+
+inline constexpr float infinity = std::numeric_limits<float>::infinity();
+
+struct Ray
+{
+    Ray() = default;
+
+    Ray(const glm::vec3 &origin, const glm::vec3 &direction, float tMax = infinity)
+        : origin {origin},
+          direction {direction},
+          tMax {tMax}
+    {
+    }
+
+    glm::vec3 at(float t) const { return origin + direction * t; }
+
+    glm::vec3 origin {0.0f};
+    glm::vec3 direction {0.0f, 0.0f, -1.0f};
+    float     tMax = infinity;
+};
+
+// a ray plus the rays through the neighbouring pixels (one to the right, one below), so the
+// hit point knows how large a pixel is there. Textures use this for their filter footprint.
+struct RayDifferential : Ray
+{
+    RayDifferential() = default;
+
+    RayDifferential(const Ray &ray) : Ray {ray} {}
+
+    bool      hasDifferentials = false;
+    glm::vec3 rxOrigin {0.0f};
+    glm::vec3 ryOrigin {0.0f};
+    glm::vec3 rxDirection {0.0f};
+    glm::vec3 ryDirection {0.0f};
+};
+
+// axis aligned bounding box. Default constructed boxes are empty, so `extend`ing them just works.
+struct Bounds3f
+{
+    Bounds3f() = default;
+
+    Bounds3f(const glm::vec3 &p) : lower {p}, upper {p} {}
+
+    Bounds3f(const glm::vec3 &a, const glm::vec3 &b)
+        : lower {glm::min(a, b)},
+          upper {glm::max(a, b)}
+    {
+    }
+
+    bool      empty() const
+    {
+        return lower.x > upper.x || lower.y > upper.y || lower.z > upper.z;
+    }
+
+    glm::vec3 diagonal() const { return upper - lower; }
+
+    glm::vec3 centroid() const { return (lower + upper) * 0.5f; }
+
+    float     surfaceArea() const
+    {
+        if (empty())
+            return 0.0f;
+        const auto d = diagonal();
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    // axis with the largest extent
+    int maxDimension() const
+    {
+        const auto d = diagonal();
+        if (d.x > d.y && d.x > d.z)
+            return 0;
+        return d.y > d.z ? 1 : 2;
+    }
+
+    void extend(const glm::vec3 &p)
+    {
+        lower = glm::min(lower, p);
+        upper = glm::max(upper, p);
+    }
+
+    void extend(const Bounds3f &b)
+    {
+        lower = glm::min(lower, b.lower);
+        upper = glm::max(upper, b.upper);
+    }
+
+    glm::vec3 lower {infinity};
+    glm::vec3 upper {-infinity};
+};
+
+inline Bounds3f merge(Bounds3f a, const Bounds3f &b)
+{
+    a.extend(b);
+    return a;
+}
+
+// bounds of `b` after transforming all eight corners by the affine `m`.
+inline Bounds3f transform(const glm::mat4 &m, const Bounds3f &b)
+{
+    if (b.empty())
+        return b;
+
+    // Arvo's method: accumulate min/max of each matrix column scaled by the box extents.
+    Bounds3f r {glm::vec3(m[3])};
+    for (int axis = 0; axis < 3; ++axis) {
+        const auto column = glm::vec3(m[axis]);
+        const auto a      = column * b.lower[axis];
+        const auto c      = column * b.upper[axis];
+        r.lower += glm::min(a, c);
+        r.upper += glm::max(a, c);
+    }
+    return r;
+}
+
+struct Triangle
+{
+    glm::vec3 v0;
+    glm::vec3 v1;
+    glm::vec3 v2;
+
+    Bounds3f  bounds() const
+    {
+        auto b = Bounds3f {v0, v1};
+        b.extend(v2);
+        return b;
+    }
+};
+
+// Moller-Trumbore. On a hit closer than `ray.tMax` returns true and writes the
+// distance and the barycentrics of `v1` and `v2`.
+inline bool intersect(const Ray      &ray,
+                      const Triangle &tri,
+                      float          &t,
+                      float          &b1,
+                      float          &b2)
+{
+    const auto e1  = tri.v1 - tri.v0;
+    const auto e2  = tri.v2 - tri.v0;
+    const auto p   = glm::cross(ray.direction, e2);
+    const auto det = glm::dot(e1, p);
+    if (std::abs(det) < 1e-12f)
+        return false;
+
+    const auto invDet = 1.0f / det;
+    const auto s      = ray.origin - tri.v0;
+    b1                = glm::dot(s, p) * invDet;
+    if (b1 < 0.0f || b1 > 1.0f)
+        return false;
+
+    const auto q = glm::cross(s, e1);
+    b2           = glm::dot(ray.direction, q) * invDet;
+    if (b2 < 0.0f || b1 + b2 > 1.0f)
+        return false;
+
+    t = glm::dot(e2, q) * invDet;
+    return t > 0.0f && t < ray.tMax;
+}
+
+}    // namespace apbr
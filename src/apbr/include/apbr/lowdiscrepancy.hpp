@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include <apbr/rng.hpp>
+
+namespace apbr {
+
+// [0, 1) float from the top 24 bits of `v`. Exact, never rounds up to one, and goes through a
+// signed conversion so loops over it vectorize.
+constexpr float toUnitFloat(std::uint32_t v)
+{
+    return static_cast<float>(static_cast<std::int32_t>(v >> 8)) * 0x1p-24f;
+}
+
+constexpr std::uint32_t reverseBits32(std::uint32_t v)
+{
+    v = (v << 16) | (v >> 16);
+    v = ((v & 0x00ff00ffu) << 8) | ((v & 0xff00ff00u) >> 8);
+    v = ((v & 0x0f0f0f0fu) << 4) | ((v & 0xf0f0f0f0u) >> 4);
+    v = ((v & 0x33333333u) << 2) | ((v & 0xccccccccu) >> 2);
+    v = ((v & 0x55555555u) << 1) | ((v & 0xaaaaaaaau) >> 1);
+    return v;
+}
+
+// Owen scrambling of a 32 bit fraction (Laine-Karras style hash, constants from pbrt-v4): every
+// bit is flipped depending on the bits above it, so power of two strata map onto strata.
+constexpr std::uint32_t owenScramble(std::uint32_t v, std::uint32_t seed)
+{
+    v = reverseBits32(v);
+    v ^= v * 0x3d20adeau;
+    v += seed;
+    v *= (seed >> 16) | 1u;
+    v ^= v * 0x05526c56u;
+    v ^= v * 0x53a22864u;
+    return reverseBits32(v);
+}
+
+// element `i` of a random permutation of [0, n), chosen by `seed` (Kensler, "Correlated
+// Multi-Jittered Sampling").
+constexpr std::uint32_t
+permutationElement(std::uint32_t i, std::uint32_t n, std::uint32_t seed)
+{
+    auto w = n - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do {
+        i ^= seed;
+        i *= 0xe170893du;
+        i ^= seed >> 16;
+        i ^= (i & w) >> 4;
+        i ^= seed >> 8;
+        i *= 0x0929eb3fu;
+        i ^= seed >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1u | seed >> 27;
+        i *= 0x6935fa69u;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303u;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3u;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3dfu;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= n);
+    return (i + seed) % n;
+}
+
+// Halton sequences
+
+// bases of the Halton dimensions. Samplers wrap around past the last one.
+inline constexpr int  primeCount = 128;
+
+inline constexpr auto primes     = [] {
+    std::array<std::uint32_t, primeCount> table {};
+    int                                   count = 0;
+    for (std::uint32_t candidate = 2; count < primeCount; ++candidate) {
+        bool prime = true;
+        for (int i = 0; i < count && table[i] * table[i] <= candidate; ++i) {
+            if (candidate % table[i] == 0) {
+                prime = false;
+                break;
+            }
+        }
+        if (prime)
+            table[count++] = candidate;
+    }
+    return table;
+}();
+
+// digits of `a` in base `primes[baseIndex]`, mirrored around the radix point.
+constexpr float radicalInverse(int baseIndex, std::uint64_t a)
+{
+    const auto base     = primes[baseIndex];
+    const auto invBase  = 1.0f / static_cast<float>(base);
+    // the reversed digits stay in 32 bits; past `limit` they are below float precision anyway.
+    const auto limit    = ~0u / base - base;
+    std::uint32_t reversed = 0;
+    float         invBaseM = 1.0f;
+    while (a != 0 && reversed < limit) {
+        const auto next  = a / base;
+        const auto digit = static_cast<std::uint32_t>(a - next * base);
+        reversed         = reversed * base + digit;
+        invBaseM *= invBase;
+        a = next;
+    }
+    return std::min(static_cast<float>(reversed) * invBaseM, oneMinusEpsilon);
+}
+
+// index whose first `digits` base `base` digits reversed give `inverse`.
+constexpr std::uint64_t
+inverseRadicalInverse(std::uint64_t inverse, std::uint32_t base, int digits)
+{
+    std::uint64_t index = 0;
+    for (int i = 0; i < digits; ++i) {
+        const auto digit = inverse % base;
+        inverse /= base;
+        index = index * base + digit;
+    }
+    return index;
+}
+
+// `radicalInverse` with every digit permuted depending on the digits before it, which is Owen
+// scrambling generalized to any base.
+constexpr float
+owenScrambledRadicalInverse(int baseIndex, std::uint64_t a, std::uint32_t seed)
+{
+    const auto base     = primes[baseIndex];
+    const auto invBase  = 1.0f / static_cast<float>(base);
+    const auto limit    = ~0u / base - base;
+    std::uint32_t reversed = 0;
+    float         invBaseM = 1.0f;
+    // unlike the plain inverse this keeps going after `a` runs out of digits: the leading zeros
+    // get scrambled too.
+    while (1.0f - invBaseM < 1.0f && reversed < limit) {
+        const auto next  = a / base;
+        auto       digit = static_cast<std::uint32_t>(a - next * base);
+        digit            = permutationElement(
+            digit,
+            base,
+            static_cast<std::uint32_t>(mixBits(seed ^ reversed)));
+        reversed = reversed * base + digit;
+        invBaseM *= invBase;
+        a = next;
+    }
+    return std::min(static_cast<float>(reversed) * invBaseM, oneMinusEpsilon);
+}
+
+// Sobol sequences
+
+inline constexpr int sobolDimensions = 16;
+
+// generator matrices, one 32 bit column per index bit. The first dimension is the van der Corput
+// sequence; the others come from the primitive polynomials and initial direction numbers of Joe
+// and Kuo's `new-joe-kuo-6.21201`.
+inline constexpr auto sobolMatrices = [] {
+    struct Polynomial
+    {
+        int           degree;
+        std::uint32_t coefficients;
+        std::uint32_t m[6];
+    };
+    constexpr Polynomial polynomials[sobolDimensions - 1] = {
+        {1,  0, {1}                  },
+        {2,  1, {1, 3}               },
+        {3,  1, {1, 3, 1}            },
+        {3,  2, {1, 1, 1}            },
+        {4,  1, {1, 1, 3, 3}         },
+        {4,  4, {1, 3, 5, 13}        },
+        {5,  2, {1, 1, 5, 5, 17}     },
+        {5,  4, {1, 1, 5, 5, 5}      },
+        {5,  7, {1, 1, 7, 11, 19}    },
+        {5, 11, {1, 1, 5, 1, 1}      },
+        {5, 13, {1, 1, 1, 3, 11}     },
+        {5, 14, {1, 3, 5, 5, 31}     },
+        {6,  1, {1, 3, 3, 9, 7, 49}  },
+        {6, 13, {1, 1, 1, 15, 21, 21}},
+        {6, 16, {1, 3, 1, 13, 27, 49}},
+    };
+
+    std::array<std::array<std::uint32_t, 32>, sobolDimensions> matrices {};
+    for (int i = 0; i < 32; ++i)
+        matrices[0][i] = 1u << (31 - i);
+
+    for (int d = 1; d < sobolDimensions; ++d) {
+        const auto &p = polynomials[d - 1];
+        auto       &v = matrices[d];
+        for (int i = 0; i < p.degree; ++i)
+            v[i] = p.m[i] << (31 - i);
+        for (int i = p.degree; i < 32; ++i) {
+            v[i] = v[i - p.degree] ^ (v[i - p.degree] >> p.degree);
+            for (int k = 1; k < p.degree; ++k)
+                v[i] ^= ((p.coefficients >> (p.degree - 1 - k)) & 1u) * v[i - k];
+        }
+    }
+    return matrices;
+}();
+
+// unscrambled bits of Sobol point `index` in `dimension`.
+constexpr std::uint32_t sobolBits(int dimension, std::uint32_t index)
+{
+    std::uint32_t v = 0;
+    for (int i = 0; index != 0; ++i, index >>= 1) {
+        if (index & 1)
+            v ^= sobolMatrices[dimension][i];
+    }
+    return v;
+}
+
+constexpr float sobolSample(int dimension, std::uint32_t index, std::uint32_t seed)
+{
+    return toUnitFloat(owenScramble(sobolBits(dimension, index), seed));
+}
+
+/// @brief `out[i] = sobolSample(dimension, first + i, seed)`, many points at once. The loops are
+/// branch free 32 bit integer code over independent samples, so they vectorize (8 lanes with
+/// AVX2).
+void sobolSamples(int              dimension,
+                  std::uint32_t    first,
+                  std::uint32_t    seed,
+                  std::span<float> out);
+
+}    // namespace apbr
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+
+// address the current function returns to, i.e. the call site of the caller.
+#if defined(_MSC_VER)
+    #include <intrin.h>
+    #define APBR_RETURN_ADDRESS() _ReturnAddress()
+#else
+    #define APBR_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+namespace apbr {
+
+// Linear allocator for memory that lives for one frame. Allocating bumps a pointer and
+// deallocating does nothing; `reset` frees everything at once. Unlike
+// `std::pmr::monotonic_buffer_resource`, `reset` keeps the memory: a frame that outgrew the
+// block makes the next block large enough for all of it, so after a few frames the arena
+// stops asking `upstream` for anything.
+//
+// Not thread safe. Give every thread an arena of its own (see `TaskScheduler::threadIndex`).
+class FrameArena : public std::pmr::memory_resource
+{
+public:
+    explicit FrameArena(std::size_t                capacity = std::size_t {1} << 20,
+                        std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+
+    FrameArena(const FrameArena &)            = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    ~FrameArena() override;
+
+    /// @brief Free everything allocated since the last reset.
+    void        reset();
+
+    // bytes handed out since the last reset, including alignment padding.
+    std::size_t used() const { return m_used; }
+
+    // size of the main block; grows to the most a frame ever used.
+    std::size_t capacity() const { return m_capacity; }
+
+private:
+    // blocks a frame overflowed into, freed or merged on `reset`. Kept at their own start.
+    struct Overflow
+    {
+        Overflow   *next;
+        std::size_t size;
+    };
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+    void  do_deallocate(void *, std::size_t, std::size_t) override {}
+
+    bool  do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    std::pmr::memory_resource *m_upstream;
+    std::byte                 *m_block    = nullptr;
+    std::size_t                m_capacity = 0;
+    // bump pointer into `m_block`, or into the newest overflow block.
+    std::byte                 *m_current  = nullptr;
+    std::byte                 *m_end      = nullptr;
+    Overflow                  *m_overflow = nullptr;
+    std::size_t                m_used     = 0;
+};
+
+// Counts allocations, their bytes and where they came from, from any number of threads and
+// without allocating itself. `heap()` counts every global `operator new` when the library is
+// built with `APBR_TRACK_ALLOCATIONS`; an `InstrumentedResource` counts what goes through it.
+//
+// Meant for checking that a steady frame allocates nothing: call `takeReport` once per frame
+// and look at what is left once the caches are warm.
+class AllocationTracker
+{
+public:
+    // distinct call sites kept per report; the rest are summed up in one entry with a null
+    // address.
+    static constexpr std::size_t maxSites = 64;
+
+    struct Site
+    {
+        const void *address     = nullptr;
+        std::size_t allocations = 0;
+        std::size_t bytes       = 0;
+    };
+
+    struct Report
+    {
+        std::size_t                    allocations = 0;
+        std::size_t                    bytes       = 0;
+        std::array<Site, maxSites + 1> sites {};
+        std::size_t                    siteCount = 0;
+
+        // by bytes, largest first.
+        std::span<const Site>          bySite() const { return {sites.data(), siteCount}; }
+    };
+
+    // Allocations made by this thread while one of these lives are not counted, e.g. those of
+    // the code printing a report.
+    class Untracked
+    {
+    public:
+        Untracked() { ++t_untracked; }
+
+        ~Untracked() { --t_untracked; }
+
+        Untracked(const Untracked &)            = delete;
+        Untracked &operator=(const Untracked &) = delete;
+    };
+
+    constexpr AllocationTracker() = default;
+
+    static AllocationTracker &heap();
+
+    // whether `heap()` sees the global heap in this build.
+    static constexpr bool     tracksHeap =
+#if defined(APBR_TRACK_ALLOCATIONS)
+        true;
+#else
+        false;
+#endif
+
+    void   record(std::size_t bytes, const void *site);
+
+    /// @brief Everything recorded since the last call, then start over.
+    Report takeReport();
+
+    /// @brief Log `report` with one line per call site, symbolized where the platform allows.
+    static void log(const Report &report, const char *what);
+
+private:
+    inline static thread_local int t_untracked = 0;
+
+    std::atomic<std::size_t>       m_allocations {0};
+    std::atomic<std::size_t>       m_bytes {0};
+    // guards `m_sites`. A spin lock, since a mutex may allocate on some platforms.
+    std::atomic_flag               m_lock;
+    // open addressed by call site; the last one sums up the sites that didn't fit.
+    std::array<Site, maxSites + 1> m_sites {};
+};
+
+// `std::pmr` resource that forwards to `upstream` and counts everything allocated through it,
+// e.g. to check what a container wrapped around a `FrameArena` or a pool still asks for.
+class InstrumentedResource : public std::pmr::memory_resource
+{
+public:
+    explicit InstrumentedResource(
+        std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+        : m_upstream {upstream}
+    {
+    }
+
+    AllocationTracker       &tracker() { return m_tracker; }
+
+    const AllocationTracker &tracker() const { return m_tracker; }
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        m_tracker.record(bytes, APBR_RETURN_ADDRESS());
+        return m_upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+    {
+        m_upstream->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    std::pmr::memory_resource *m_upstream;
+    AllocationTracker          m_tracker;
+};
+
+}    // namespace apbr
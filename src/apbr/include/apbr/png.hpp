@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace apbr {
+
+/// @brief Write 8 bit RGB pixels, top row first, as a PNG file (with `stb_image_write`).
+/// @return false if `rgb` is too small or the file can't be written.
+bool writePNG(const std::filesystem::path   &path,
+              int                            width,
+              int                            height,
+              std::span<const std::uint8_t> rgb);
+
+}    // namespace apbr
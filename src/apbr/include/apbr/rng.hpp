@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace apbr {
+
+// 64 bit finalizer (MurmurHash3 / splitmix style), for seeding and hashing sample indices.
+constexpr std::uint64_t mixBits(std::uint64_t v)
+{
+    v ^= v >> 31;
+    v *= 0x7fb5d329728ea185ull;
+    v ^= v >> 27;
+    v *= 0x81dadef4bc2dd44dull;
+    v ^= v >> 33;
+    return v;
+}
+
+// hash of a few integers, e.g. a pixel, a dimension and a seed.
+template <typename... Ts>
+constexpr std::uint64_t hash(std::uint64_t first, Ts... rest)
+{
+    auto h = mixBits(first);
+    ((h = mixBits(h ^ (static_cast<std::uint64_t>(rest) + 0x9e3779b97f4a7c15ull))),
+     ...);
+    return h;
+}
+
+// largest float below one, so `[0, 1)` samples never round up to 1.
+inline constexpr float oneMinusEpsilon = 0x1.fffffep-1f;
+
+// PCG32 (https://www.pcg-random.org), the generator the PBR book uses.
+class RNG
+{
+public:
+    constexpr RNG() = default;
+
+    constexpr RNG(std::uint64_t sequence, std::uint64_t seed)
+    {
+        setSequence(sequence, seed);
+    }
+
+    constexpr explicit RNG(std::uint64_t sequence)
+    {
+        setSequence(sequence, mixBits(sequence));
+    }
+
+    constexpr void setSequence(std::uint64_t sequence, std::uint64_t seed)
+    {
+        m_state = 0;
+        m_inc   = (sequence << 1u) | 1u;
+        uniformUInt32();
+        m_state += seed;
+        uniformUInt32();
+    }
+
+    constexpr std::uint32_t uniformUInt32()
+    {
+        const auto old = m_state;
+        m_state        = old * multiplier + m_inc;
+        const auto xorShifted =
+            static_cast<std::uint32_t>(((old >> 18u) ^ old) >> 27u);
+        const auto rot = static_cast<std::uint32_t>(old >> 59u);
+        return (xorShifted >> rot) | (xorShifted << ((~rot + 1u) & 31));
+    }
+
+    // uniform in [0, 1)
+    constexpr float uniformFloat()
+    {
+        return std::min(oneMinusEpsilon, uniformUInt32() * 0x1p-32f);
+    }
+
+    // jump `delta` steps ahead (or back) in O(log delta).
+    constexpr void advance(std::int64_t delta)
+    {
+        std::uint64_t curMult = multiplier, curPlus = m_inc, accMult = 1u,
+                      accPlus = 0u;
+        auto          d       = static_cast<std::uint64_t>(delta);
+        while (d > 0) {
+            if (d & 1) {
+                accMult *= curMult;
+                accPlus = accPlus * curMult + curPlus;
+            }
+            curPlus = (curMult + 1) * curPlus;
+            curMult *= curMult;
+            d /= 2;
+        }
+        m_state = accMult * m_state + accPlus;
+    }
+
+private:
+    static constexpr std::uint64_t multiplier = 0x5851f42d4c957f2dull;
+
+    std::uint64_t                  m_state    = 0x853c49e6748fea9bull;
+    std::uint64_t                  m_inc      = 0xda3e39cb94b95bdbull;
+};
+
+}    // namespace apbr
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+namespace apbr {
+
+inline constexpr float pi = 3.14159265358979323846f;
+
+// uniform disk sample from `u` in [0, 1)^2 (Shirley-Chiu concentric mapping).
+inline glm::vec2 sampleUniformDiskConcentric(const glm::vec2 &u)
+{
+    const auto offset = u * 2.0f - glm::vec2 {1.0f};
+    if (offset.x == 0.0f && offset.y == 0.0f)
+        return glm::vec2 {0.0f};
+
+    float r, theta;
+    if (std::abs(offset.x) > std::abs(offset.y)) {
+        r     = offset.x;
+        theta = (pi / 4.0f) * (offset.y / offset.x);
+    } else {
+        r     = offset.y;
+        theta = pi / 2.0f - (pi / 4.0f) * (offset.x / offset.y);
+    }
+    return r * glm::vec2 {std::cos(theta), std::sin(theta)};
+}
+
+// cosine weighted direction around +z; the pdf is `cos(theta) / pi`.
+inline glm::vec3 sampleCosineHemisphere(const glm::vec2 &u)
+{
+    const auto d = sampleUniformDiskConcentric(u);
+    const auto z = std::sqrt(std::max(0.0f, 1.0f - d.x * d.x - d.y * d.y));
+    return {d.x, d.y, z};
+}
+
+// orthonormal basis around a unit vector (Duff et al. 2017).
+inline void coordinateSystem(const glm::vec3 &n, glm::vec3 &t, glm::vec3 &b)
+{
+    const float sign = std::copysign(1.0f, n.z);
+    const float a    = -1.0f / (sign + n.z);
+    const float c    = n.x * n.y * a;
+    t                = {1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x};
+    b                = {c, sign + n.y * n.y * a, -n.y};
+}
+
+// transform `v` from the local frame around `n` (`+z` = `n`) into world space.
+inline glm::vec3 fromLocal(const glm::vec3 &n, const glm::vec3 &v)
+{
+    glm::vec3 t, b;
+    coordinateSystem(n, t, b);
+    return t * v.x + b * v.y + n * v.z;
+}
+
+}    // namespace apbr
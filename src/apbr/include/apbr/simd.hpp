@@ -0,0 +1,369 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__)
+    #define APBR_SIMD_AVX2 1
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)                                     \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define APBR_SIMD_SSE 1
+    #include <emmintrin.h>
+#endif
+
+// Thin wrappers over the widest float vector the build targets (AVX2 -> 8 lanes, SSE2 -> 4 lanes).
+// Targets without either fall back to plain arrays, so everything here always compiles.
+namespace apbr::simd {
+
+#if defined(APBR_SIMD_AVX2)
+inline constexpr int width = 8;
+#else
+inline constexpr int width = 4;
+#endif
+
+// full lane mask, e.g. `bits(mask) == all_lanes`
+inline constexpr std::uint32_t all_lanes = (1u << width) - 1;
+
+struct vmask
+{
+#if defined(APBR_SIMD_AVX2)
+    __m256 v;
+#elif defined(APBR_SIMD_SSE)
+    __m128 v;
+#else
+    bool v[width];
+#endif
+};
+
+struct vfloat
+{
+#if defined(APBR_SIMD_AVX2)
+    __m256 v;
+#elif defined(APBR_SIMD_SSE)
+    __m128 v;
+#else
+    float v[width];
+#endif
+};
+
+#if defined(APBR_SIMD_AVX2)
+
+inline vfloat broadcast(float x) { return {_mm256_set1_ps(x)}; }
+
+inline vfloat load(const float *p) { return {_mm256_loadu_ps(p)}; }
+
+inline void store(float *p, vfloat a) { _mm256_storeu_ps(p, a.v); }
+
+inline vfloat operator+(vfloat a, vfloat b) { return {_mm256_add_ps(a.v, b.v)}; }
+
+inline vfloat operator-(vfloat a, vfloat b) { return {_mm256_sub_ps(a.v, b.v)}; }
+
+inline vfloat operator*(vfloat a, vfloat b) { return {_mm256_mul_ps(a.v, b.v)}; }
+
+inline vfloat operator/(vfloat a, vfloat b) { return {_mm256_div_ps(a.v, b.v)}; }
+
+inline vfloat min(vfloat a, vfloat b) { return {_mm256_min_ps(a.v, b.v)}; }
+
+inline vfloat max(vfloat a, vfloat b) { return {_mm256_max_ps(a.v, b.v)}; }
+
+inline vfloat fmadd(vfloat a, vfloat b, vfloat c)
+{
+    return {_mm256_fmadd_ps(a.v, b.v, c.v)};
+}
+
+inline vfloat abs(vfloat a)
+{
+    return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)};
+}
+
+inline vmask operator<(vfloat a, vfloat b)
+{
+    return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)};
+}
+
+inline vmask operator<=(vfloat a, vfloat b)
+{
+    return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)};
+}
+
+inline vmask operator>(vfloat a, vfloat b)
+{
+    return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)};
+}
+
+inline vmask operator>=(vfloat a, vfloat b)
+{
+    return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)};
+}
+
+inline vmask operator&(vmask a, vmask b) { return {_mm256_and_ps(a.v, b.v)}; }
+
+inline vmask operator|(vmask a, vmask b) { return {_mm256_or_ps(a.v, b.v)}; }
+
+// `a & ~b`
+inline vmask andnot(vmask a, vmask b) { return {_mm256_andnot_ps(b.v, a.v)}; }
+
+inline vfloat select(vmask m, vfloat a, vfloat b)
+{
+    return {_mm256_blendv_ps(b.v, a.v, m.v)};
+}
+
+inline std::uint32_t bits(vmask m)
+{
+    return static_cast<std::uint32_t>(_mm256_movemask_ps(m.v));
+}
+
+inline vmask from_bits(std::uint32_t b)
+{
+    const __m256i lane = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i set  = _mm256_and_si256(_mm256_set1_epi32(int(b)), lane);
+    return {_mm256_castsi256_ps(_mm256_cmpeq_epi32(set, lane))};
+}
+
+// exp(x) to ~1e-4 relative error; x is clamped to [-87, 87].
+inline vfloat exp(vfloat x)
+{
+    __m256 t = _mm256_mul_ps(
+        _mm256_max_ps(_mm256_min_ps(x.v, _mm256_set1_ps(87.0f)),
+                      _mm256_set1_ps(-87.0f)),
+        _mm256_set1_ps(1.44269504f));
+    __m256  fi = _mm256_floor_ps(t);
+    __m256  f  = _mm256_sub_ps(t, fi);
+    // 2^f on [0, 1)
+    __m256  p  = _mm256_fmadd_ps(_mm256_set1_ps(0.0790225f),
+                                 f,
+                                 _mm256_set1_ps(0.2249929f));
+    p          = _mm256_fmadd_ps(p, f, _mm256_set1_ps(0.6966226f));
+    p          = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0000000f));
+    __m256i e  = _mm256_slli_epi32(
+        _mm256_add_epi32(_mm256_cvtps_epi32(fi), _mm256_set1_epi32(127)),
+        23);
+    return {_mm256_mul_ps(p, _mm256_castsi256_ps(e))};
+}
+
+#elif defined(APBR_SIMD_SSE)
+
+inline vfloat broadcast(float x) { return {_mm_set1_ps(x)}; }
+
+inline vfloat load(const float *p) { return {_mm_loadu_ps(p)}; }
+
+inline void store(float *p, vfloat a) { _mm_storeu_ps(p, a.v); }
+
+inline vfloat operator+(vfloat a, vfloat b) { return {_mm_add_ps(a.v, b.v)}; }
+
+inline vfloat operator-(vfloat a, vfloat b) { return {_mm_sub_ps(a.v, b.v)}; }
+
+inline vfloat operator*(vfloat a, vfloat b) { return {_mm_mul_ps(a.v, b.v)}; }
+
+inline vfloat operator/(vfloat a, vfloat b) { return {_mm_div_ps(a.v, b.v)}; }
+
+inline vfloat min(vfloat a, vfloat b) { return {_mm_min_ps(a.v, b.v)}; }
+
+inline vfloat max(vfloat a, vfloat b) { return {_mm_max_ps(a.v, b.v)}; }
+
+inline vfloat fmadd(vfloat a, vfloat b, vfloat c)
+{
+    return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)};
+}
+
+inline vfloat abs(vfloat a)
+{
+    return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)};
+}
+
+inline vmask operator<(vfloat a, vfloat b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+
+inline vmask operator<=(vfloat a, vfloat b) { return {_mm_cmple_ps(a.v, b.v)}; }
+
+inline vmask operator>(vfloat a, vfloat b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+
+inline vmask operator>=(vfloat a, vfloat b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+
+inline vmask operator&(vmask a, vmask b) { return {_mm_and_ps(a.v, b.v)}; }
+
+inline vmask operator|(vmask a, vmask b) { return {_mm_or_ps(a.v, b.v)}; }
+
+// `a & ~b`
+inline vmask andnot(vmask a, vmask b) { return {_mm_andnot_ps(b.v, a.v)}; }
+
+inline vfloat select(vmask m, vfloat a, vfloat b)
+{
+    return {_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))};
+}
+
+inline std::uint32_t bits(vmask m)
+{
+    return static_cast<std::uint32_t>(_mm_movemask_ps(m.v));
+}
+
+inline vmask from_bits(std::uint32_t b)
+{
+    const __m128i lane = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128i set  = _mm_and_si128(_mm_set1_epi32(int(b)), lane);
+    return {_mm_castsi128_ps(_mm_cmpeq_epi32(set, lane))};
+}
+
+// exp(x) to ~1e-4 relative error; x is clamped to [-87, 87].
+inline vfloat exp(vfloat x)
+{
+    __m128 t = _mm_mul_ps(_mm_max_ps(_mm_min_ps(x.v, _mm_set1_ps(87.0f)),
+                                     _mm_set1_ps(-87.0f)),
+                          _mm_set1_ps(1.44269504f));
+    // floor without SSE4.1: truncate, then step down for negative fractions
+    __m128i ti = _mm_cvttps_epi32(t);
+    __m128  fi = _mm_cvtepi32_ps(ti);
+    __m128  gt = _mm_cmpgt_ps(fi, t);
+    fi         = _mm_sub_ps(fi, _mm_and_ps(gt, _mm_set1_ps(1.0f)));
+    ti         = _mm_cvttps_epi32(fi);
+    __m128 f   = _mm_sub_ps(t, fi);
+    // 2^f on [0, 1)
+    __m128 p   = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.0790225f), f),
+                            _mm_set1_ps(0.2249929f));
+    p          = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.6966226f));
+    p          = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0000000f));
+    __m128i e =
+        _mm_slli_epi32(_mm_add_epi32(ti, _mm_set1_epi32(127)), 23);
+    return {_mm_mul_ps(p, _mm_castsi128_ps(e))};
+}
+
+#else
+
+inline vfloat broadcast(float x)
+{
+    vfloat r;
+    for (int i = 0; i < width; ++i)
+        r.v[i] = x;
+    return r;
+}
+
+inline vfloat load(const float *p)
+{
+    vfloat r;
+    for (int i = 0; i < width; ++i)
+        r.v[i] = p[i];
+    return r;
+}
+
+inline void store(float *p, vfloat a)
+{
+    for (int i = 0; i < width; ++i)
+        p[i] = a.v[i];
+}
+
+    #define APBR_SIMD_LANEWISE(ret, name, expr)                                \
+        inline ret name(vfloat a, vfloat b)                                    \
+        {                                                                      \
+            ret r;                                                             \
+            for (int i = 0; i < width; ++i)                                    \
+                r.v[i] = (expr);                                               \
+            return r;                                                          \
+        }
+
+APBR_SIMD_LANEWISE(vfloat, operator+, a.v[i] + b.v[i])
+APBR_SIMD_LANEWISE(vfloat, operator-, a.v[i] - b.v[i])
+APBR_SIMD_LANEWISE(vfloat, operator*, a.v[i] * b.v[i])
+APBR_SIMD_LANEWISE(vfloat, operator/, a.v[i] / b.v[i])
+APBR_SIMD_LANEWISE(vfloat, min, b.v[i] < a.v[i] ? b.v[i] : a.v[i])
+APBR_SIMD_LANEWISE(vfloat, max, b.v[i] > a.v[i] ? b.v[i] : a.v[i])
+APBR_SIMD_LANEWISE(vmask, operator<, a.v[i] < b.v[i])
+APBR_SIMD_LANEWISE(vmask, operator<=, a.v[i] <= b.v[i])
+APBR_SIMD_LANEWISE(vmask, operator>, a.v[i] > b.v[i])
+APBR_SIMD_LANEWISE(vmask, operator>=, a.v[i] >= b.v[i])
+
+    #undef APBR_SIMD_LANEWISE
+
+inline vfloat fmadd(vfloat a, vfloat b, vfloat c) { return a * b + c; }
+
+inline vfloat abs(vfloat a)
+{
+    for (int i = 0; i < width; ++i)
+        a.v[i] = std::fabs(a.v[i]);
+    return a;
+}
+
+inline vmask operator&(vmask a, vmask b)
+{
+    for (int i = 0; i < width; ++i)
+        a.v[i] = a.v[i] && b.v[i];
+    return a;
+}
+
+inline vmask operator|(vmask a, vmask b)
+{
+    for (int i = 0; i < width; ++i)
+        a.v[i] = a.v[i] || b.v[i];
+    return a;
+}
+
+// `a & ~b`
+inline vmask andnot(vmask a, vmask b)
+{
+    for (int i = 0; i < width; ++i)
+        a.v[i] = a.v[i] && !b.v[i];
+    return a;
+}
+
+inline vfloat select(vmask m, vfloat a, vfloat b)
+{
+    for (int i = 0; i < width; ++i)
+        b.v[i] = m.v[i] ? a.v[i] : b.v[i];
+    return b;
+}
+
+inline std::uint32_t bits(vmask m)
+{
+    std::uint32_t r = 0;
+    for (int i = 0; i < width; ++i)
+        r |= std::uint32_t(m.v[i]) << i;
+    return r;
+}
+
+inline vmask from_bits(std::uint32_t b)
+{
+    vmask r;
+    for (int i = 0; i < width; ++i)
+        r.v[i] = (b >> i) & 1u;
+    return r;
+}
+
+inline vfloat exp(vfloat x)
+{
+    for (int i = 0; i < width; ++i)
+        x.v[i] = std::exp(x.v[i]);
+    return x;
+}
+
+#endif
+
+inline bool any(vmask m) { return bits(m) != 0; }
+
+inline bool none(vmask m) { return bits(m) == 0; }
+
+inline bool all(vmask m) { return bits(m) == all_lanes; }
+
+// the first `count` lanes from `p`, the others zero; for the tail of an array.
+inline vfloat loadPartial(const float *p, int count)
+{
+    if (count >= width)
+        return load(p);
+    float lanes[width] = {};
+    for (int i = 0; i < count; ++i)
+        lanes[i] = p[i];
+    return load(lanes);
+}
+
+// store the first `count` lanes of `a` to `p`.
+inline void storePartial(float *p, vfloat a, int count)
+{
+    if (count >= width) {
+        store(p, a);
+        return;
+    }
+    float lanes[width];
+    store(lanes, a);
+    for (int i = 0; i < count; ++i)
+        p[i] = lanes[i];
+}
+
+}    // namespace apbr::simd
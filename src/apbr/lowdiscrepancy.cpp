@@ -0,0 +1,41 @@
+#include <algorithm>
+#include <bit>
+
+#include <apbr/lowdiscrepancy.hpp>
+
+namespace apbr {
+
+void sobolSamples(int              dimension,
+                  std::uint32_t    first,
+                  std::uint32_t    seed,
+                  std::span<float> out)
+{
+    constexpr std::size_t chunkSize = 64;
+    const auto           &matrix    = sobolMatrices[dimension];
+
+    std::uint32_t         bits[chunkSize];
+    float                 values[chunkSize];
+    for (std::size_t begin = 0; begin < out.size(); begin += chunkSize) {
+        const auto count = std::min(chunkSize, out.size() - begin);
+        const auto base  = first + static_cast<std::uint32_t>(begin);
+        const auto last  = base + static_cast<std::uint32_t>(count - 1);
+        // only the columns the largest index reaches, unless the indices wrap around.
+        const int  columns = last < base ? 32 : std::bit_width(last);
+
+        // always a full chunk: a fixed trip count vectorizes even at -O2. Column by column, so
+        // the inner loop runs across samples instead of along one index.
+        std::fill_n(bits, chunkSize, 0u);
+        for (int column = 0; column < columns; ++column) {
+            const auto c = matrix[column];
+            for (std::size_t i = 0; i < chunkSize; ++i) {
+                const auto index = base + static_cast<std::uint32_t>(i);
+                bits[i] ^= c & (0u - ((index >> column) & 1u));
+            }
+        }
+        for (std::size_t i = 0; i < chunkSize; ++i)
+            values[i] = toUnitFloat(owenScramble(bits[i], seed));
+        std::copy_n(values, count, out.begin() + begin);
+    }
+}
+
+}    // namespace apbr
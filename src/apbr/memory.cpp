@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <new>
+#include <string>
+
+#include <apbr/Logger.hpp>
+#include <apbr/memory.hpp>
+#include <apbr/rng.hpp>
+
+#if __has_include(<dlfcn.h>)
+    #include <dlfcn.h>
+    #define APBR_HAS_DLADDR 1
+#endif
+
+namespace {
+
+using apbr::AllocationTracker;
+
+constexpr std::size_t blockAlignment = alignof(std::max_align_t);
+
+std::byte *alignUp(std::byte *p, std::size_t alignment)
+{
+    const auto address = reinterpret_cast<std::uintptr_t>(p);
+    return p + ((alignment - address % alignment) % alignment);
+}
+
+class SpinLock
+{
+public:
+    explicit SpinLock(std::atomic_flag &flag) : m_flag {flag}
+    {
+        while (m_flag.test_and_set(std::memory_order_acquire))
+            m_flag.wait(true, std::memory_order_relaxed);
+    }
+
+    ~SpinLock()
+    {
+        m_flag.clear(std::memory_order_release);
+        m_flag.notify_one();
+    }
+
+    SpinLock(const SpinLock &)            = delete;
+    SpinLock &operator=(const SpinLock &) = delete;
+
+private:
+    std::atomic_flag &m_flag;
+};
+
+// function and offset, or module and offset, of a code address.
+std::string describe(const void *address)
+{
+    if (!address)
+        return "other call sites";
+#if defined(APBR_HAS_DLADDR)
+    Dl_info info;
+    if (dladdr(address, &info) != 0) {
+        const auto *code = static_cast<const char *>(address);
+        if (info.dli_sname) {
+            return std::format("{}+{:#x}",
+                               info.dli_sname,
+                               code - static_cast<const char *>(info.dli_saddr));
+        }
+        if (info.dli_fname) {
+            return std::format("{}+{:#x}",
+                               info.dli_fname,
+                               code - static_cast<const char *>(info.dli_fbase));
+        }
+    }
+#endif
+    return std::format("{}", address);
+}
+
+// trivially destructible, so allocations made while statics are destroyed still find it.
+constinit AllocationTracker heapTracker;
+
+}    // namespace
+
+namespace apbr {
+
+FrameArena::FrameArena(std::size_t capacity, std::pmr::memory_resource *upstream)
+    : m_upstream {upstream},
+      m_capacity {std::max<std::size_t>(capacity, 64)}
+{
+    m_block   = static_cast<std::byte *>(m_upstream->allocate(m_capacity, blockAlignment));
+    m_current = m_block;
+    m_end     = m_block + m_capacity;
+}
+
+FrameArena::~FrameArena()
+{
+    while (m_overflow) {
+        auto *next = m_overflow->next;
+        m_upstream->deallocate(m_overflow, m_overflow->size, blockAlignment);
+        m_overflow = next;
+    }
+    m_upstream->deallocate(m_block, m_capacity, blockAlignment);
+}
+
+void *FrameArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    auto *p = alignUp(m_current, alignment);
+    if (p > m_end || static_cast<std::size_t>(m_end - p) < bytes) {
+        // carry on in a new block; `reset` folds it into the main one.
+        const auto size =
+            std::max(m_capacity, sizeof(Overflow) + alignment + bytes);
+        auto *block = static_cast<std::byte *>(m_upstream->allocate(size, blockAlignment));
+        m_overflow  = ::new (block) Overflow {m_overflow, size};
+        m_current   = block + sizeof(Overflow);
+        m_end       = block + size;
+        p           = alignUp(m_current, alignment);
+    }
+    m_used    += static_cast<std::size_t>(p + bytes - m_current);
+    m_current  = p + bytes;
+    return p;
+}
+
+void FrameArena::reset()
+{
+    if (m_overflow) {
+        // the frame needed `m_used` bytes; give the next one a block with room to spare.
+        while (m_overflow) {
+            auto *next = m_overflow->next;
+            m_upstream->deallocate(m_overflow, m_overflow->size, blockAlignment);
+            m_overflow = next;
+        }
+        m_upstream->deallocate(m_block, m_capacity, blockAlignment);
+        m_capacity = std::max(2 * m_capacity, m_used + m_used / 2);
+        m_block    = static_cast<std::byte *>(m_upstream->allocate(m_capacity, blockAlignment));
+    }
+    m_current = m_block;
+    m_end     = m_block + m_capacity;
+    m_used    = 0;
+}
+
+AllocationTracker &AllocationTracker::heap() { return heapTracker; }
+
+void AllocationTracker::record(std::size_t bytes, const void *site)
+{
+    if (t_untracked > 0)
+        return;
+
+    m_allocations.fetch_add(1, std::memory_order_relaxed);
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+    SpinLock lock {m_lock};
+    auto     slot = site ? mixBits(reinterpret_cast<std::uintptr_t>(site)) % maxSites : maxSites;
+    for (std::size_t probe = 0; site && probe < maxSites; ++probe) {
+        if (m_sites[slot].address == site || m_sites[slot].address == nullptr)
+            break;
+        slot = (slot + 1) % maxSites;
+        if (probe + 1 == maxSites)
+            slot = maxSites;
+    }
+    auto &entry   = m_sites[slot];
+    entry.address = slot == maxSites ? nullptr : site;
+    ++entry.allocations;
+    entry.bytes += bytes;
+}
+
+AllocationTracker::Report AllocationTracker::takeReport()
+{
+    Report   report;
+    SpinLock lock {m_lock};
+    report.allocations = m_allocations.exchange(0, std::memory_order_relaxed);
+    report.bytes       = m_bytes.exchange(0, std::memory_order_relaxed);
+    for (auto &site : m_sites) {
+        if (site.allocations != 0)
+            report.sites[report.siteCount++] = site;
+        site = {};
+    }
+    std::sort(report.sites.begin(),
+              report.sites.begin() + static_cast<std::ptrdiff_t>(report.siteCount),
+              [](const Site &a, const Site &b) { return a.bytes > b.bytes; });
+    return report;
+}
+
+void AllocationTracker::log(const Report &report, const char *what)
+{
+    // the report itself allocates; none of it should show up in the next one.
+    Untracked untracked;
+
+    const auto summary =
+        std::format("{}: {} allocations, {} bytes.", what, report.allocations, report.bytes);
+    if (report.allocations == 0) {
+        logger.log(summary);
+        return;
+    }
+    logger.logWarn(summary);
+    for (const auto &site : report.bySite()) {
+        logger.logWarn(std::format("    {} allocations, {} bytes from {}",
+                                   site.allocations,
+                                   site.bytes,
+                                   describe(site.address)));
+    }
+}
+
+}    // namespace apbr
+
+#if defined(APBR_TRACK_ALLOCATIONS)
+
+// Replacements of the global allocation functions that count into `AllocationTracker::heap()`,
+// with the caller of `operator new` as the call site. The memory comes from `malloc`.
+
+namespace {
+
+void *trackedAllocate(std::size_t  size,
+                      std::size_t  alignment,
+                      const void  *site,
+                      bool         nothrow)
+{
+    heapTracker.record(size, site);
+    size = std::max<std::size_t>(size, 1);
+
+    void *p = nullptr;
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        p = std::malloc(size);
+    } else {
+    #if defined(_WIN32)
+        p = _aligned_malloc(size, alignment);
+    #else
+        p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    #endif
+    }
+    if (!p && !nothrow)
+        throw std::bad_alloc {};
+    return p;
+}
+
+void trackedRelease(void *p, std::size_t alignment)
+{
+    #if defined(_WIN32)
+    if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        _aligned_free(p);
+        return;
+    }
+    #else
+    (void) alignment;
+    #endif
+    std::free(p);
+}
+
+constexpr std::size_t defaultAlignment = 0;
+
+}    // namespace
+
+void *operator new(std::size_t size)
+{
+    return trackedAllocate(size, defaultAlignment, APBR_RETURN_ADDRESS(), false);
+}
+
+void *operator new[](std::size_t size)
+{
+    return trackedAllocate(size, defaultAlignment, APBR_RETURN_ADDRESS(), false);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return trackedAllocate(size, defaultAlignment, APBR_RETURN_ADDRESS(), true);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return trackedAllocate(size, defaultAlignment, APBR_RETURN_ADDRESS(), true);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return trackedAllocate(size,
+                           static_cast<std::size_t>(alignment),
+                           APBR_RETURN_ADDRESS(),
+                           false);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return trackedAllocate(size,
+                           static_cast<std::size_t>(alignment),
+                           APBR_RETURN_ADDRESS(),
+                           false);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return trackedAllocate(size,
+                           static_cast<std::size_t>(alignment),
+                           APBR_RETURN_ADDRESS(),
+                           true);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return trackedAllocate(size,
+                           static_cast<std::size_t>(alignment),
+                           APBR_RETURN_ADDRESS(),
+                           true);
+}
+
+void operator delete(void *p) noexcept { trackedRelease(p, defaultAlignment); }
+
+void operator delete[](void *p) noexcept { trackedRelease(p, defaultAlignment); }
+
+void operator delete(void *p, std::size_t) noexcept { trackedRelease(p, defaultAlignment); }
+
+void operator delete[](void *p, std::size_t) noexcept { trackedRelease(p, defaultAlignment); }
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    trackedRelease(p, defaultAlignment);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+    trackedRelease(p, defaultAlignment);
+}
+
+void operator delete(void *p, std::align_val_t alignment) noexcept
+{
+    trackedRelease(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *p, std::align_val_t alignment) noexcept
+{
+    trackedRelease(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t alignment) noexcept
+{
+    trackedRelease(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t alignment) noexcept
+{
+    trackedRelease(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *p, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    trackedRelease(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *p, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    trackedRelease(p, static_cast<std::size_t>(alignment));
+}
+
+#endif
@@ -0,0 +1,27 @@
+#include <string>
+
+#include <stb_image_write.h>
+
+#include <apbr/png.hpp>
+
+namespace apbr {
+
+bool writePNG(const std::filesystem::path   &path,
+              int                            width,
+              int                            height,
+              std::span<const std::uint8_t> rgb)
+{
+    const auto rowBytes = 3 * static_cast<std::size_t>(width);
+    if (width <= 0 || height <= 0 || rgb.size() < rowBytes * height)
+        return false;
+
+    return stbi_write_png(path.string().c_str(),
+                          width,
+                          height,
+                          3,
+                          rgb.data(),
+                          static_cast<int>(rowBytes))
+        != 0;
+}
+
+}    // namespace apbr
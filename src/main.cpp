@@ -1,6 +1,9 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
 #include <format>
 #include <iostream>
 #include <string_view>
@@ -8,6 +11,11 @@
 #include <memory>
 #include <string>
 #include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <span>
+#include <utility>
+#include <vector>
 
 #include <apbr/apbr.hpp>
 #include <stb/stb_image.h>
@@ -64,10 +72,13 @@ private:
     {
         /*----------------------SHADER CREATION-----------------------------------------------*/
 
+        // the sources are only needed until they are compiled.
+        apbr::FrameArena shaderSources {std::size_t {64} << 10};
+
         auto vertexShader =
-            apbr::Shader::vertexShaderFromFile("shaders/rect.vert");
+            apbr::Shader::vertexShaderFromFile("shaders/rect.vert", &shaderSources);
         auto fragShader =
-            apbr::Shader::fragmentShaderFromFile("shaders/rect.frag");
+            apbr::Shader::fragmentShaderFromFile("shaders/rect.frag", &shaderSources);
 
         auto shaderProgram = apbr::ShaderProgram();
         shaderProgram.attach(vertexShader);
@@ -143,14 +154,40 @@ private:
                               reinterpret_cast<void *>(6 * sizeof(GLfloat)));
         glEnableVertexAttribArray(texCoordLocation);
 
-        auto const bgTexture =
-            load_texture2D("textures/wooden-container.jpg", GL_RGB);
+        // decode both images on the shared task pool; only the upload needs the GL context.
+        Image bgImage, fgImage;
+        {
+            auto           &scheduler = apbr::TaskScheduler::global();
+            apbr::TaskGroup decoding;
+            scheduler.run(decoding, [&] {
+                bgImage = load_image("textures/wooden-container.jpg");
+            });
+            scheduler.run(decoding, [&] {
+                fgImage = load_image("textures/awesomeface.png");
+            });
+            scheduler.wait(decoding);
+        }
+
+        // the preview's path tracer textures the quads with the same image, so copy it into a
+        // CPU texture before the upload frees it.
+        std::shared_ptr<const apbr::Texture> previewAlbedo;
+        if (bgImage.data) {
+            previewAlbedo = std::make_shared<const apbr::Texture>(
+                bgImage.width,
+                bgImage.height,
+                bgImage.channels,
+                std::span<const std::uint8_t> {
+                    bgImage.data,
+                    static_cast<std::size_t>(bgImage.width) * bgImage.height
+                        * bgImage.channels});
+        }
+
+        auto const bgTexture = load_texture2D(bgImage, GL_RGB);
         // set wrapping/filtering options for the bound texture object
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-        auto const fgTexture =
-            load_texture2D("textures/awesomeface.png", GL_RGBA);
+        auto const fgTexture = load_texture2D(fgImage, GL_RGBA);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
@@ -159,6 +196,18 @@ private:
         auto transform =
             glm::translate(identity_mat4, glm::vec3(0.45f, -0.45f, 0));
 
+        // transforms of the quads, read by the rasterizer and by the preview's path
+        // tracer. The backdrop only exists in the preview.
+        apbr::Scene             scene;
+        const apbr::Scene::Node quadNodes[]    = {scene.addNode(transform),
+                                                  scene.addNode()};
+        const apbr::Scene::Node previewNodes[] = {quadNodes[0],
+                                                  quadNodes[1],
+                                                  scene.addNode()};
+        // of the quad mesh, before the transforms.
+        const apbr::Bounds3f    quadBounds {glm::vec3 {-0.5f, -0.5f, 0.0f},
+                                            glm::vec3 {0.5f, 0.5f, 0.0f}};
+
         shaderProgram.use();
         auto const transformLocation =
             glGetUniformLocation(shaderProgram.handle(), "transform");
@@ -176,11 +225,205 @@ private:
         glUniform1f(fgOpacityLocation, fgOpacity);
         const static float opacityChangeFactor = 0.0001f;
 
+        // path traced preview of the same quads, toggled with `P`.
+        auto const hdrPreviewLocation =
+            glGetUniformLocation(shaderProgram.handle(), "hdrPreview");
+        glUniform1i(hdrPreviewLocation, 0);
+        auto const exposureLocation =
+            glGetUniformLocation(shaderProgram.handle(), "exposure");
+        glUniform1f(exposureLocation, 1.0f);
+
+        auto camera = apbr::Camera {
+            glm::vec3 {0.0f, 0.0f, 2.0f},
+            glm::vec3 {0.0f},
+            glm::vec3 {0.0f, 1.0f, 0.0f},
+            glm::radians(45.0f),
+            static_cast<float>(m_width) / static_cast<float>(m_height)};
+        std::unique_ptr<apbr::ProgressiveRenderer> preview;
+        std::unique_ptr<apbr::StreamingTexture>    previewTexture;
+        std::shared_ptr<const apbr::Accel>         previewScene;
+        // where the quads were when the preview last restarted, and how far (in world units)
+        // any of their corners may move from there before it restarts again.
+        glm::mat4                                  restartTransforms[std::size(quadNodes)];
+        const static float                         restartDistance = 0.05f;
+        bool                                       previewKeyDown = false;
+        // `O` writes the latest preview image to renders/, denoised unless `N` turned
+        // that off.
+        const apbr::ProgressiveRenderer::Image    *previewImage   = nullptr;
+        apbr::Denoiser                             denoiser;
+        bool                                       denoisePreview = true;
+        bool                                       saveKeyDown    = false;
+        bool                                       denoiseKeyDown = false;
+        // `M` switches the preview between uniform and adaptive sampling.
+        apbr::AdaptiveSamplingOptions              adaptiveSampling;
+        bool                                       adaptiveKeyDown = false;
+        const static float                         cameraSpeed    = 0.01f;
+
+        apbr::RenderQueue                          renderQueue;
+        // the quads' transforms go straight to clip space, so they are culled against the
+        // identity. There is no depth buffer to build a `HiZBuffer` from.
+        apbr::Culler                               culler;
+        // with APBR_TRACK_ALLOCATIONS, rasterized frames past the first few are expected
+        // not to touch the heap; any that do are logged with their call sites.
+        const static int                           warmupFrames = 10;
+        int                                        steadyFrames = 0;
+
         // render loop
         while (m_window->is_open()) {
             if (m_window->getKeyState(GLFW_KEY_ESCAPE) == GLFW_PRESS) {
                 m_window->close();
             }
+            renderQueue.beginFrame();
+
+            transform = glm::rotate(
+                transform,
+                glm::radians(sin(static_cast<float>(glfwGetTime()))),
+                glm::vec3(0.0f, 0.0f, 1.0f));
+            scene.setLocal(quadNodes[0], transform);
+            scene.setLocal(quadNodes[1], animatedTransform(identity_mat4));
+            const auto movedNodes = scene.update();
+
+            const bool previewKey =
+                m_window->getKeyState(GLFW_KEY_P) == GLFW_PRESS;
+            if (previewKey && !previewKeyDown) {
+                if (preview) {
+                    preview.reset();
+                    previewTexture.reset();
+                    previewScene.reset();
+                    previewImage = nullptr;
+                } else {
+                    previewScene = buildPreviewScene(
+                        vertices,
+                        rect_indices,
+                        {scene.world(quadNodes[0]), scene.world(quadNodes[1])},
+                        previewAlbedo);
+                    preview = std::make_unique<apbr::ProgressiveRenderer>(
+                        m_width,
+                        m_height,
+                        std::make_shared<apbr::AOIntegrator>(previewScene),
+                        camera);
+                    preview->setAdaptiveSampling(adaptiveSampling);
+                    for (std::size_t i = 0; i < std::size(quadNodes); ++i)
+                        restartTransforms[i] = scene.world(quadNodes[i]);
+                    previewTexture = std::make_unique<apbr::StreamingTexture>(
+                        m_width,
+                        m_height);
+                }
+            }
+            previewKeyDown = previewKey;
+
+            if (preview) {
+                // WASD pans, Q/E moves in and out. Any change restarts accumulation.
+                const std::pair<int, glm::vec3> moves[] = {
+                    {GLFW_KEY_W, { 0.0f,  1.0f,  0.0f}},
+                    {GLFW_KEY_S, { 0.0f, -1.0f,  0.0f}},
+                    {GLFW_KEY_A, {-1.0f,  0.0f,  0.0f}},
+                    {GLFW_KEY_D, { 1.0f,  0.0f,  0.0f}},
+                    {GLFW_KEY_Q, { 0.0f,  0.0f,  1.0f}},
+                    {GLFW_KEY_E, { 0.0f,  0.0f, -1.0f}},
+                };
+                for (const auto &[key, direction] : moves) {
+                    if (m_window->getKeyState(key) == GLFW_PRESS)
+                        camera.translate(direction * cameraSpeed);
+                }
+                preview->setCamera(camera);
+
+                // the render thread may still be tracing the current scene, so refit a copy
+                // (the meshes are shared) and hand that over instead. Small moves keep
+                // accumulating and blur a little; once a quad corner strayed too far from
+                // where it was at the last restart, accumulation starts over.
+                if (movedNodes > 0) {
+                    auto next = std::make_shared<apbr::Accel>(*previewScene);
+                    next->setTransforms(scene, previewNodes);
+                    previewScene = std::move(next);
+                    auto integrator = std::make_shared<apbr::AOIntegrator>(previewScene);
+
+                    float moved = 0.0f;
+                    for (std::size_t i = 0; i < std::size(quadNodes); ++i) {
+                        const auto &world = scene.world(quadNodes[i]);
+                        for (int corner = 0; corner < 4; ++corner) {
+                            const auto p = glm::vec4 {corner & 1 ? quadBounds.upper.x
+                                                                 : quadBounds.lower.x,
+                                                      corner & 2 ? quadBounds.upper.y
+                                                                 : quadBounds.lower.y,
+                                                      0.0f,
+                                                      1.0f};
+                            moved = std::max(
+                                moved,
+                                glm::length(glm::vec3 {world * p - restartTransforms[i] * p}));
+                        }
+                    }
+                    if (moved > restartDistance) {
+                        preview->setIntegrator(std::move(integrator));
+                        for (std::size_t i = 0; i < std::size(quadNodes); ++i)
+                            restartTransforms[i] = scene.world(quadNodes[i]);
+                    } else {
+                        preview->updateIntegrator(std::move(integrator));
+                    }
+                }
+
+                // never waits: either there's a new pass or we keep showing the last one,
+                // which may still have to make it out of its pixel buffer.
+                if (auto const *image = preview->acquire()) {
+                    previewTexture->update(image->rgb);
+                    previewImage = image;
+                } else {
+                    previewTexture->flush();
+                }
+
+                const bool denoiseKey =
+                    m_window->getKeyState(GLFW_KEY_N) == GLFW_PRESS;
+                if (denoiseKey && !denoiseKeyDown) {
+                    denoisePreview = !denoisePreview;
+                    logger.log(std::format("Denoising saved previews: {}",
+                                           denoisePreview ? "on" : "off"));
+                }
+                denoiseKeyDown = denoiseKey;
+
+                const bool adaptiveKey =
+                    m_window->getKeyState(GLFW_KEY_M) == GLFW_PRESS;
+                if (adaptiveKey && !adaptiveKeyDown) {
+                    adaptiveSampling.enabled = !adaptiveSampling.enabled;
+                    preview->setAdaptiveSampling(adaptiveSampling);
+                    logger.log(std::format("Adaptive sampling: {}",
+                                           adaptiveSampling.enabled ? "on" : "off"));
+                }
+                adaptiveKeyDown = adaptiveKey;
+
+                const bool saveKey =
+                    m_window->getKeyState(GLFW_KEY_O) == GLFW_PRESS;
+                if (saveKey && !saveKeyDown && previewImage)
+                    savePreview(*previewImage,
+                                denoisePreview ? &denoiser : nullptr);
+                saveKeyDown = saveKey;
+
+                glClear(GL_COLOR_BUFFER_BIT);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, previewTexture->handle());
+                glUniform1i(hdrPreviewLocation, 1);
+
+                // the quad spans [-0.5, 0.5]; scaled by two it covers the viewport.
+                auto const fullscreen =
+                    glm::scale(identity_mat4, glm::vec3(2.0f, 2.0f, 1.0f));
+                glUniformMatrix4fv(transformLocation,
+                                   1,
+                                   GL_FALSE,
+                                   glm::value_ptr(fullscreen));
+                glBindVertexArray(VAO);
+                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+                glUniform1i(hdrPreviewLocation, 0);
+
+                // the preview allocates every frame (a new `Accel` and integrator), so it
+                // isn't checked.
+                if constexpr (apbr::AllocationTracker::tracksHeap) {
+                    apbr::AllocationTracker::heap().takeReport();
+                    steadyFrames = 0;
+                }
+
+                m_window->swapBuffers();
+                glfwPollEvents();
+                continue;
+            }
 
             if (m_window->getKeyState(GLFW_KEY_UP) == GLFW_PRESS) {
                 fgOpacity += opacityChangeFactor;
@@ -200,49 +443,168 @@ private:
             glClear(GL_COLOR_BUFFER_BIT);
             glClearColor(0.4, 0.3, 0.8, 1.0);
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, bgTexture);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, fgTexture);
-
-            transform = glm::rotate(
-                transform,
-                glm::radians(sin(static_cast<float>(glfwGetTime()))),
-                glm::vec3(0.0f, 0.0f, 1.0f));
-
-            glUniformMatrix4fv(transformLocation,
-                               1,
-                               GL_FALSE,
-                               glm::value_ptr(transform));
-
-            glBindVertexArray(VAO);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-            auto transform2 =
-                glm::translate(identity_mat4, glm::vec3(-0.49f, 0.39f, 0));
-            transform2 =
-                glm::scale(transform2,
-                           glm::vec3 {sin(static_cast<float>(glfwGetTime()))});
-            glUniformMatrix4fv(transformLocation,
-                               1,
-                               GL_FALSE,
-                               &transform2[0][0]);
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            apbr::Bounds3f worldBounds[std::size(quadNodes)];
+            for (std::size_t i = 0; i < std::size(quadNodes); ++i)
+                worldBounds[i] = apbr::transform(scene.world(quadNodes[i]), quadBounds);
+            culler.setBounds(worldBounds);
+            const auto visible = culler.cull(identity_mat4);
+
+            // the visible quads are recorded on the task pool; only the submit needs the
+            // context.
+            auto record = [&](std::size_t first, std::size_t last) {
+                for (auto v = first; v < last; ++v) {
+                    const auto        i = visible[v];
+                    apbr::DrawCommand command;
+                    command.program           = shaderProgram.handle();
+                    command.vertexArray       = VAO;
+                    command.textures[0]       = bgTexture;
+                    command.textures[1]       = fgTexture;
+                    command.transformLocation = transformLocation;
+                    command.transform         = scene.world(quadNodes[i]);
+                    command.indexCount        = 6;
+                    // the quads are flat, so the depth of their origin, from clip space
+                    // [-1, 1] to [0, 1].
+                    command.key = apbr::makeDrawKey(apbr::RenderPass::Opaque,
+                                                    command.program,
+                                                    bgTexture,
+                                                    command.transform[3].z * 0.5f
+                                                        + 0.5f);
+                    renderQueue.record(command);
+                }
+            };
+            // one chunk per thread, so even a couple of quads get split off to the workers
+            // instead of all being recorded on the thread owning the context.
+            auto      &scheduler = apbr::TaskScheduler::global();
+            const auto threads   = std::size_t {scheduler.threadCount()};
+            scheduler.parallelFor(0,
+                                  visible.size(),
+                                  (visible.size() + threads - 1) / threads,
+                                  record);
+            renderQueue.submit();
+
+            if constexpr (apbr::AllocationTracker::tracksHeap) {
+                const auto report = apbr::AllocationTracker::heap().takeReport();
+                if (++steadyFrames > warmupFrames && report.allocations > 0)
+                    apbr::AllocationTracker::log(report, "Heap allocations this frame");
+            }
 
             m_window->swapBuffers();
             glfwPollEvents();
         }
     }
 
-    GLuint
-    load_texture2D(const char *path, GLenum format, bool flip_on_load = true)
+    // the second quad pulses around its corner of the screen. Its scale never reaches 0, so
+    // the transform stays invertible for the preview's instances.
+    static glm::mat4 animatedTransform(const glm::mat4 &identity_mat4)
+    {
+        auto transform2 =
+            glm::translate(identity_mat4, glm::vec3(-0.49f, 0.39f, 0));
+        const auto scale = std::sin(static_cast<float>(glfwGetTime()));
+        return glm::scale(
+            transform2,
+            glm::vec3 {std::copysign(std::max(std::abs(scale), 0.05f), scale)});
+    }
+
+    // tone maps `image` like rect.frag does and writes it to renders/, after filtering it
+    // with `denoiser` if there is one.
+    void savePreview(const apbr::ProgressiveRenderer::Image &image,
+                     apbr::Denoiser                         *denoiser) const
+    {
+        std::vector<float> rgb = image.rgb;
+        if (denoiser) {
+            denoiser->denoise({m_width,
+                               m_height,
+                               image.rgb,
+                               image.albedo,
+                               image.normal,
+                               image.depth},
+                              rgb);
+        }
+
+        // ACES filmic curve fit by Krzysztof Narkowicz, then gamma 2.2.
+        auto encode = [](float x) {
+            const auto mapped = std::clamp(
+                (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f),
+                0.0f,
+                1.0f);
+            return static_cast<std::uint8_t>(
+                std::pow(mapped, 1.0f / 2.2f) * 255.0f + 0.5f);
+        };
+
+        // the preview is stored bottom row first, PNGs start at the top.
+        const auto rowFloats = 3 * static_cast<std::size_t>(m_width);
+        std::vector<std::uint8_t> pixels(rgb.size());
+        for (int y = 0; y < m_height; ++y) {
+            const auto *src = &rgb[(m_height - 1 - y) * rowFloats];
+            auto       *dst = &pixels[y * rowFloats];
+            for (std::size_t i = 0; i < rowFloats; ++i)
+                dst[i] = encode(std::max(src[i], 0.0f));
+        }
+
+        const auto path = std::filesystem::path {"renders"}
+                        / std::format("preview-{}spp{}.png",
+                                      image.samplesPerPixel,
+                                      denoiser ? "-denoised" : "");
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+        if (apbr::writePNG(path, m_width, m_height, pixels))
+            logger.log(std::format("Saved `{}`.", path.string()));
+        else
+            logger.logError(std::format("Failed to save `{}`.", path.string()));
+    }
+
+    // the quads as seen by the rasterizer, placed in front of a backdrop so there is
+    // something to occlude. Both quads instance one mesh; the backdrop comes last and
+    // keeps the identity transform.
+    static std::shared_ptr<const apbr::Accel>
+    buildPreviewScene(std::span<const GLfloat>             vertices,
+                      std::span<const GLuint>              indices,
+                      std::initializer_list<glm::mat4>    transforms,
+                      std::shared_ptr<const apbr::Texture> albedo)
     {
-        // load texture using stbi_load
-        int    width    = 0;
-        int    height   = 0;
-        int    channels = 0;
+        // every vertex is 8 floats: position, color, texture coordinates.
+        std::vector<glm::vec3> corners;
+        std::vector<glm::vec2> uvs;
+        for (std::size_t i = 0; i + 8 <= vertices.size(); i += 8) {
+            corners.push_back(
+                glm::vec3 {vertices[i], vertices[i + 1], vertices[i + 2]});
+            uvs.push_back(glm::vec2 {vertices[i + 6], vertices[i + 7]});
+        }
+        const std::vector<std::uint32_t> quadIndices(indices.begin(),
+                                                     indices.end());
+        auto quad = std::make_shared<const apbr::TriangleMesh>(
+            std::move(corners),
+            quadIndices,
+            std::move(uvs));
+
+        auto backdrop = std::make_shared<const apbr::TriangleMesh>(
+            std::vector<glm::vec3> {
+                { 2.0f,  2.0f, -0.25f},
+                {-2.0f,  2.0f, -0.25f},
+                {-2.0f, -2.0f, -0.25f},
+                { 2.0f, -2.0f, -0.25f},
+            },
+            quadIndices);
+
+        std::vector<apbr::Instance> instances;
+        for (const auto &transform : transforms)
+            instances.push_back({quad, transform, albedo});
+        instances.push_back({std::move(backdrop), glm::mat4 {1.0f}, nullptr});
+
+        return std::make_shared<const apbr::Accel>(std::move(instances));
+    }
 
+    struct Image
+    {
+        int      width    = 0;
+        int      height   = 0;
+        int      channels = 0;
+        stbi_uc *data     = nullptr;
+    };
+
+    // uploads and frees `image`.
+    GLuint load_texture2D(Image &image, GLenum format)
+    {
         GLuint texture;
         glGenTextures(1, &texture);
         glBindTexture(GL_TEXTURE_2D, texture);
@@ -251,38 +613,39 @@ private:
                         GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-        stbi_set_flip_vertically_on_load(flip_on_load);
-        auto bg_tex_handle = load_image(width, height, channels, path);
-
         glTexImage2D(GL_TEXTURE_2D,         // texture target
                      0,                     // mipmap level
                      GL_RGB,                // texture store format
-                     width,
-                     height,
+                     image.width,
+                     image.height,
                      0,                     // legacy: set 0
                      format,                // format of image
                      GL_UNSIGNED_BYTE,      // data type of image
-                     bg_tex_handle          // image data
+                     image.data             // image data
         );
         glGenerateMipmap(GL_TEXTURE_2D);    // generate mipmaps for the texture
 
-        free_image(bg_tex_handle);
+        free_image(image.data);
+        image.data = nullptr;
 
         return texture;
     }
 
-    stbi_uc *
-    load_image(int &width, int &height, int &channels, const char *path)
+    // does not touch GL, so it can run on any thread.
+    Image load_image(const char *path, bool flip_on_load = true)
     {
-        auto tex_handle = stbi_load(path, &width, &height, &channels, 0);
+        Image image;
+        stbi_set_flip_vertically_on_load_thread(flip_on_load);
+        image.data =
+            stbi_load(path, &image.width, &image.height, &image.channels, 0);
 
-        if (!tex_handle) {
+        if (!image.data) {
             logger.logError(std::format("Failed to load texture: {}", path));
-            return nullptr;
+            return image;
         }
 
         logger.log(std::format("Image `{}` loaded successfully.", path));
-        return tex_handle;
+        return image;
     }
 
     void free_image(stbi_uc *image) { stbi_image_free(image); }